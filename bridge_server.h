@@ -0,0 +1,1200 @@
+#pragma once
+
+#include "transport.h"
+#include "websocket_transport.h"
+#include "stream_transport.h"
+#include "shm_transport.h"
+
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <Windows.h>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <charconv>
+#include <random>
+#include "logging.h"
+#include "protocol.h"
+#include "request_table.h"
+#include "completion_executor.h"
+#include "lz.h"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+// Request layer on top of a Transport: request IDs, timeouts, response routing and the hello
+// handshake. The wire is picked by IMCLASS_ENDPOINT (ws://, tcp://, unix:// or shm://), the default
+// ws://0.0.0.0:9001 is what imclass_server.as connects to.
+class BridgeServer {
+private:
+    static constexpr std::chrono::milliseconds REQUEST_TIMEOUT{ 5000 };
+    // how long requests are held for a bridge that dropped off to come back and resume the session
+    static constexpr std::chrono::milliseconds RESUME_GRACE{ 3000 };
+
+    net::io_context ioc;
+    // transports run their socket work on this strand, the timeout timer too
+    transport::executor strand;
+    net::steady_timer timeout_timer;
+    std::thread server_thread;
+    std::mutex queue_mutex;
+
+    std::unique_ptr<Transport> link;
+    transport::Endpoint endpoint;
+
+    // unsolicited messages (no request_id) are only kept if someone asked for them via enable_mailbox
+    std::deque<std::string> incoming_messages;
+    size_t mailbox_capacity = 0;
+    size_t mailbox_dropped = 0;
+    RequestTable pending_requests;
+    // callbacks run here, never on a transport thread
+    CompletionExecutor completions;
+    std::vector<RequestTable::Request> expired_requests;
+
+    bool running = false;
+
+    // what the bridge on the other end said it can do, reset on every disconnect
+    std::mutex session_mutex;
+    protocol::capabilities session_caps;
+    // hot-path copies of session_caps for mem::
+    std::atomic<uint32_t> session_ops{ 0 };
+    std::atomic<uint32_t> session_max_payload{ 0 };
+
+    // what we accept in one frame, Beast's default websocket message limit
+    static constexpr uint32_t MAX_INCOMING_FRAME = 16 * 1024 * 1024;
+    // payloads below this go out raw, compressing them costs the bridge more than it saves on the wire
+    static constexpr uint32_t COMPRESS_THRESHOLD = 4096;
+
+public:
+    struct FlowStats {
+        uint32_t window = 0;
+        uint32_t in_flight = 0;
+        size_t queued = 0;
+        size_t peak_queued = 0;
+        size_t queued_by_priority[priority_count] = {};
+        uint64_t deferred = 0;  // requests that had to wait for credit
+        uint64_t dropped = 0;   // requests refused because the backlog was full
+        uint64_t expired = 0;   // requests whose deadline passed while they were queued
+    };
+
+    static constexpr uint32_t DEFAULT_WINDOW = 64;
+
+    // sequence, whether the bytes are a protocol::applyDelta delta or the whole range, then the bytes.
+    // The view is only valid for the duration of the call.
+    using PushCallback = std::function<void(uint32_t, bool, const uint8_t*, size_t)>;
+
+    struct CompressionStats {
+        uint64_t frames = 0;
+        uint64_t wire_bytes = 0;    // compressed payloads as received
+        uint64_t raw_bytes = 0;     // the same payloads inflated
+        uint64_t inflate_us = 0;
+        uint64_t failures = 0;
+    };
+
+    // What the bridge said in its last hello about the process it has attached. session is the
+    // session_id() that hello started, it only changes when a new hello came in.
+    struct Attachment {
+        uint64_t session = 0;
+        bool resumed = false;   // it came back with our session token, nothing it held was lost
+        uint32_t pid = 0;
+        uint64_t base = 0;
+    };
+
+    struct PushStats {
+        uint64_t full = 0;
+        uint64_t delta = 0;
+        uint64_t bytes = 0;     // push payloads as received
+        uint64_t resyncs = 0;
+    };
+
+private:
+    // Flow control: at most `window` requests are on the wire, every response or timeout hands a credit
+    // back and the backlog is sent as credits come in, highest priority first and in order within a
+    // priority. Background work is held to part of the window so interactive reads always find a free
+    // credit soon. A queued request holds its table slot unarmed, so waiting here never counts against
+    // its timeout; one that outlives its deadline is dropped without being sent.
+    struct QueuedRequest {
+        uint32_t id;
+        transport::Message message;
+        std::chrono::steady_clock::time_point deadline;
+        requestPriority priority;
+        bool replayable;
+        uint64_t sequence = 0;      // send order, set once it goes on the wire
+    };
+
+    static constexpr size_t MAX_BACKLOG = RequestTable::SLOT_COUNT;
+    static constexpr auto NO_DEADLINE = (std::chrono::steady_clock::time_point::max)();
+
+    std::mutex flow_mutex;
+    std::deque<QueuedRequest> backlog[priority_count];
+    size_t backlog_size = 0;
+    uint32_t window = DEFAULT_WINDOW;
+    // the bridge can ask for a smaller window in its hello, 0 = no limit from its side
+    uint32_t bridge_window = 0;
+    uint32_t in_flight = 0;
+    FlowStats flow_counters;
+
+    // Session resume: the hello_ack hands the bridge a token, a bridge that reconnects with it still has
+    // everything it had (process attached, nothing reset). Requests on the wire are tracked until
+    // answered; when the link drops, reads among them go back into the backlog and everything waits
+    // for the bridge to come back (resuming) instead of failing. The message copy is only kept for
+    // reads, the rest can't be sent twice.
+    std::string session_token;
+    std::unordered_map<uint32_t, QueuedRequest> sent;
+    uint64_t send_sequence = 0;
+    bool resuming = false;
+    uint64_t resume_serial = 0;
+    Attachment session_attachment;
+
+    // Ranges the bridge pushes on its own. Subscriptions belong to a session, the bridge forgets them
+    // on disconnect so they're dropped here too and session_serial moves on.
+    std::mutex push_mutex;
+    std::unordered_map<uint32_t, PushCallback> subscriptions;
+    uint32_t next_subscription = 1;
+    std::atomic<bool> session_push{ false };
+    std::atomic<uint64_t> session_serial{ 0 };
+    PushStats push_counters;
+
+    // only touched by the transport thread, stats are read under compression_mutex
+    std::vector<uint8_t> inflate_buffer;
+    std::mutex compression_mutex;
+    CompressionStats compression_counters;
+
+    // The message being handled, a view into the transport's read buffer. Replies in it that go to a
+    // completion share one copy of it, made the first time one needs it. Only touched by the transport thread.
+    const uint8_t* received_data = nullptr;
+    size_t received_size = 0;
+    std::shared_ptr<const std::vector<uint8_t>> received_copy;
+
+    // Bytes a completion still reads after the transport moved on, and who keeps them alive
+    struct HeldBytes {
+        std::shared_ptr<const std::vector<uint8_t>> owner;
+        const uint8_t* data = nullptr;
+    };
+
+    // what a request that never got its answer is completed with
+    static constexpr std::string_view DROPPED_REPLY = R"({"success":false,"error":"dropped"})";
+
+    static std::string environment(const char* name, const char* fallback) {
+        char value[256];
+        DWORD length = GetEnvironmentVariableA(name, value, sizeof(value));
+        return (length && length < sizeof(value)) ? std::string(value, length) : std::string(fallback);
+    }
+
+    std::unique_ptr<Transport> make_transport(const transport::Endpoint& target) {
+        if (target.scheme == "ws") {
+            return std::make_unique<WebSocketTransport>(strand);
+        }
+        if (target.scheme == "tcp") {
+            return std::make_unique<TcpTransport>(strand, "TCP");
+        }
+        if (target.scheme == "unix") {
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            return std::make_unique<UnixTransport>(strand, "Unix");
+#else
+            logger::addLog("[Bridge] Unix sockets aren't supported by this build");
+            return nullptr;
+#endif
+        }
+        if (target.scheme == "shm") {
+            return std::make_unique<ShmTransport>(strand);
+        }
+        return nullptr;
+    }
+
+    transport::Handlers make_handlers() {
+        transport::Handlers handlers;
+        handlers.disconnected = [this]() {
+            park_in_flight();
+            set_session(protocol::capabilities{});
+        };
+        handlers.message = [this](bool binary, const uint8_t* data, size_t size) {
+            received_data = data;
+            received_size = size;
+            received_copy.reset();
+
+            if (binary) {
+                process_binary_message(data, size);
+            }
+            else {
+                process_response(std::string_view(reinterpret_cast<const char*>(data), size));
+            }
+
+            received_data = nullptr;
+            received_size = 0;
+            received_copy.reset();
+        };
+        return handlers;
+    }
+
+    void queue_message(transport::Message message) {
+        if (!link || !link->is_connected()) {
+            logger::addLog("[Bridge] Cannot send - not connected");
+            return;
+        }
+
+        link->send(std::move(message));
+    }
+
+    uint32_t effective_window() const {
+        return bridge_window ? (std::min)(window, bridge_window) : window;
+    }
+
+    // Background work leaves a quarter of the window free for everything else
+    uint32_t credit_limit(requestPriority priority) const {
+        uint32_t limit = effective_window();
+        return (priority == priority_background) ? (std::max)(limit - limit / 4, 1u) : limit;
+    }
+
+    // Highest priority with something queued, priority_count if the backlog is empty
+    int first_queued() const {
+        for (int priority = 0; priority < priority_count; priority++) {
+            if (!backlog[priority].empty()) {
+                return priority;
+            }
+        }
+        return priority_count;
+    }
+
+    // Sends right away when there's credit, otherwise parks the request in the backlog
+    bool dispatch(uint32_t id, transport::Message message, requestPriority priority, std::chrono::steady_clock::time_point deadline,
+        bool replayable) {
+        bool refused = false;
+        {
+            std::lock_guard<std::mutex> lock(flow_mutex);
+            // a new request never overtakes queued work of the same or higher priority
+            if (resuming || in_flight >= credit_limit(priority) || first_queued() <= priority) {
+                if (backlog_size >= MAX_BACKLOG) {
+                    flow_counters.dropped++;
+                    refused = true;
+                }
+                else {
+                    backlog[priority].push_back({ id, std::move(message), deadline, priority, replayable });
+                    backlog_size++;
+                    flow_counters.deferred++;
+                    flow_counters.peak_queued = (std::max)(flow_counters.peak_queued, backlog_size);
+                    return true;
+                }
+            }
+            else {
+                in_flight++;
+                sent[id] = { id, replayable ? message : transport::Message{}, deadline, priority, replayable, ++send_sequence };
+            }
+        }
+
+        if (refused) {
+            RequestTable::Request dropped;
+            pending_requests.take(id, dropped);
+            logger::addLog("[Bridge] Request backlog full, dropping request: " + dropped.type);
+            return false;
+        }
+
+        pending_requests.arm(id, REQUEST_TIMEOUT);
+        queue_message(std::move(message));
+        return true;
+    }
+
+    static std::chrono::steady_clock::time_point deadline_after(std::chrono::milliseconds budget) {
+        return budget.count() > 0 ? std::chrono::steady_clock::now() + budget : NO_DEADLINE;
+    }
+
+    // Hands credits back and sends whatever the freed window allows
+    void release_credits(uint32_t count) {
+        std::vector<QueuedRequest> ready;
+        std::vector<uint32_t> expired;
+        {
+            std::lock_guard<std::mutex> lock(flow_mutex);
+            in_flight -= (std::min)(count, in_flight);
+
+            auto now = std::chrono::steady_clock::now();
+            // nothing goes out while waiting for a resume, the backlog is sent as a whole once it's in
+            int priority;
+            while (!resuming && (priority = first_queued()) < priority_count) {
+                auto& queue = backlog[priority];
+                if (queue.front().deadline <= now) {
+                    expired.push_back(queue.front().id);
+                }
+                else if (in_flight < credit_limit(static_cast<requestPriority>(priority))) {
+                    auto& queued = queue.front();
+                    sent[queued.id] = { queued.id, queued.replayable ? queued.message : transport::Message{},
+                        queued.deadline, queued.priority, queued.replayable, ++send_sequence };
+                    ready.push_back(std::move(queued));
+                    in_flight++;
+                }
+                else {
+                    break;
+                }
+                queue.pop_front();
+                backlog_size--;
+            }
+            flow_counters.expired += expired.size();
+        }
+
+        drop_requests(expired);
+
+        if (ready.empty()) {
+            return;
+        }
+
+        std::vector<transport::Message> messages;
+        messages.reserve(ready.size());
+        for (auto& queued : ready) {
+            pending_requests.arm(queued.id, REQUEST_TIMEOUT);
+            messages.push_back(std::move(queued.message));
+        }
+
+        if (link && link->is_connected()) {
+            link->send_batch(std::move(messages));
+        }
+    }
+
+    // The request got its answer or timed out, it's off the wire
+    void forget_sent(uint32_t id) {
+        std::lock_guard<std::mutex> lock(flow_mutex);
+        sent.erase(id);
+    }
+
+    // The link dropped with requests on the wire. Reads go back to the front of the backlog to be sent
+    // again if the bridge resumes the session; anything else may or may not have happened on the other
+    // side and fails right away. Nothing goes out until the bridge is back or RESUME_GRACE has passed.
+    void park_in_flight() {
+        std::vector<uint32_t> failed;
+        std::vector<QueuedRequest> parked;
+        size_t held = 0;
+        uint64_t serial;
+        {
+            std::lock_guard<std::mutex> lock(flow_mutex);
+            for (auto& [id, request] : sent) {
+                if (request.replayable) {
+                    // back to waiting, its timeout starts over when it's sent again. One that can't be
+                    // disarmed got its answer just now.
+                    if (pending_requests.disarm(id)) {
+                        parked.push_back(std::move(request));
+                    }
+                }
+                else {
+                    failed.push_back(id);
+                }
+            }
+            sent.clear();
+
+            // replayed in the order they first went out, ahead of anything that never left the backlog
+            std::sort(parked.begin(), parked.end(), [](const QueuedRequest& a, const QueuedRequest& b) {
+                return a.sequence < b.sequence;
+            });
+            for (auto it = parked.rbegin(); it != parked.rend(); ++it) {
+                backlog[it->priority].push_front(std::move(*it));
+                backlog_size++;
+            }
+            in_flight = 0;
+            resuming = true;
+            held = backlog_size;
+            serial = ++resume_serial;
+        }
+
+        drop_requests(failed);
+        logger::addLog("[Bridge] Holding " + std::to_string(held) + " requests for a session resume, failed " +
+            std::to_string(failed.size()) + " that can't be replayed");
+
+        defer(RESUME_GRACE, [this, serial]() {
+            {
+                std::lock_guard<std::mutex> lock(flow_mutex);
+                if (!resuming || serial != resume_serial) {
+                    return;
+                }
+                resuming = false;
+            }
+
+            logger::addLog("[Bridge] Bridge didn't come back, dropping held requests");
+            drop_backlog();
+            });
+    }
+
+    // The bridge said hello again. With our token it kept everything and the held requests go out,
+    // a new bridge may have nothing attached so they're dropped instead.
+    void finish_resume(bool resumed) {
+        {
+            std::lock_guard<std::mutex> lock(flow_mutex);
+            if (!resuming) {
+                return;
+            }
+            resuming = false;
+            resume_serial++;
+        }
+
+        if (resumed) {
+            logger::addLog("[Bridge] Session resumed, sending held requests");
+            release_credits(0);
+        }
+        else {
+            drop_backlog();
+        }
+    }
+
+    // Completes a request that won't get an answer as failed, the reply says why
+    void fail_request(RequestTable::Request& request) {
+        if (request.callback) {
+            completions.post(std::move(request.type), request.timestamp, [callback = std::move(request.callback)]() {
+                callback(DROPPED_REPLY);
+            });
+        }
+        else if (request.binary_callback) {
+            completions.post(std::move(request.type), request.timestamp, [callback = std::move(request.binary_callback)]() {
+                callback(false, nullptr, 0);
+            });
+        }
+    }
+
+    void drop_requests(const std::vector<uint32_t>& ids) {
+        for (uint32_t id : ids) {
+            RequestTable::Request request;
+            if (pending_requests.take(id, request)) {
+                fail_request(request);
+            }
+        }
+    }
+
+    // Keeps size bytes at data alive past the current message: a view into the message itself
+    // shares the one copy of it, inflated bytes take inflate_buffer along instead
+    HeldBytes hold(const uint8_t* data, size_t size) {
+        HeldBytes held;
+        if (!size) {
+            return held;
+        }
+
+        std::less<const uint8_t*> before;
+        if (!before(data, received_data) && before(data, received_data + received_size)) {
+            if (!received_copy) {
+                received_copy = std::make_shared<const std::vector<uint8_t>>(received_data, received_data + received_size);
+            }
+            held.owner = received_copy;
+            held.data = received_copy->data() + (data - received_data);
+            return held;
+        }
+
+        // moving the vector keeps its storage, data still points into it
+        held.owner = std::make_shared<const std::vector<uint8_t>>(std::move(inflate_buffer));
+        inflate_buffer = {};
+        held.data = data;
+        return held;
+    }
+
+    // Queued requests past their deadline, checked with the timeout tick
+    void drop_expired(std::chrono::steady_clock::time_point now) {
+        std::vector<uint32_t> expired;
+        {
+            std::lock_guard<std::mutex> lock(flow_mutex);
+            for (auto& queue : backlog) {
+                for (auto it = queue.begin(); it != queue.end();) {
+                    if (it->deadline <= now) {
+                        expired.push_back(it->id);
+                        it = queue.erase(it);
+                        backlog_size--;
+                    }
+                    else {
+                        ++it;
+                    }
+                }
+            }
+            flow_counters.expired += expired.size();
+        }
+
+        drop_requests(expired);
+    }
+
+    // Nothing queued survives a disconnect, the callers see their requests dropped
+    void drop_backlog() {
+        std::vector<uint32_t> dropped;
+        {
+            std::lock_guard<std::mutex> lock(flow_mutex);
+            for (auto& queue : backlog) {
+                for (auto& queued : queue) {
+                    dropped.push_back(queued.id);
+                }
+                queue.clear();
+            }
+            backlog_size = 0;
+        }
+
+        drop_requests(dropped);
+        if (!dropped.empty()) {
+            logger::addLog("[Bridge] Dropped " + std::to_string(dropped.size()) + " queued requests on disconnect");
+        }
+    }
+
+    // Pulls the top level "request_id" value out without parsing the message. The bridge always sends it as
+    // a quoted decimal string; a key inside a JSON string would have escaped quotes, so it can't match here.
+    static bool find_request_id(std::string_view message, uint32_t& id) {
+        constexpr std::string_view key = "\"request_id\"";
+
+        size_t pos = message.find(key);
+        if (pos == std::string_view::npos) {
+            return false;
+        }
+
+        pos += key.size();
+        while (pos < message.size() && (message[pos] == ' ' || message[pos] == ':' || message[pos] == '"')) {
+            pos++;
+        }
+
+        auto result = std::from_chars(message.data() + pos, message.data() + message.size(), id);
+        return result.ec == std::errc();
+    }
+
+    void process_batch(std::string_view message) {
+        size_t start = message.find('\n');
+        while (start != std::string_view::npos) {
+            size_t end = message.find('\n', start + 1);
+            std::string_view line = message.substr(start + 1, end == std::string_view::npos ? std::string_view::npos : end - start - 1);
+            if (!line.empty()) {
+                process_response(line);
+            }
+            start = end;
+        }
+    }
+
+    void process_response(std::string_view message) {
+        if (message.starts_with(protocol::batchPrefix)) {
+            process_batch(message);
+            return;
+        }
+
+        uint32_t id = 0;
+        if (find_request_id(message, id)) {
+            RequestTable::Request request;
+            if (!pending_requests.take(id, request)) {
+                logger::addLog("[Bridge] Received response for unknown request ID: " + std::to_string(id));
+                return;
+            }
+            forget_sent(id);
+            release_credits(1);
+
+            if (request.callback) {
+                // the read buffer is reused for the next read, the completion shares a copy of the message
+                auto callback = std::move(request.callback);
+                auto held = hold(reinterpret_cast<const uint8_t*>(message.data()), message.size());
+                completions.post(std::move(request.type), request.timestamp,
+                    [callback = std::move(callback), held = std::move(held), size = message.size()]() {
+                        callback(std::string_view(reinterpret_cast<const char*>(held.data), size));
+                    });
+            }
+            return;
+        }
+
+        process_unsolicited(message);
+    }
+
+    void set_session(const protocol::capabilities& caps) {
+        {
+            std::lock_guard<std::mutex> lock(session_mutex);
+            session_caps = caps;
+        }
+
+        uint32_t ops = 0;
+        for (uint8_t op : protocol::knownOps) {
+            if (caps.hasOp(op)) {
+                ops |= 1u << op;
+            }
+        }
+        session_ops = ops;
+        session_max_payload = caps.maxPayload();
+        link->set_text_batching(caps.batch);
+
+        {
+            std::lock_guard<std::mutex> lock(push_mutex);
+            subscriptions.clear();
+            session_push = caps.subscriptions;
+            session_serial++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(flow_mutex);
+            bridge_window = caps.window;
+        }
+        release_credits(0);
+    }
+
+    // Hello fields are strings, a bridge sending a number or a boolean instead is read the same way.
+    // Anything else counts as missing, so one odd field falls back to its default instead of failing the hello.
+    static std::string hello_field(const json& j, const char* key) {
+        auto it = j.find(key);
+        if (it == j.end()) {
+            return {};
+        }
+        if (it->is_string()) {
+            return it->get<std::string>();
+        }
+        if (it->is_number_unsigned() || it->is_boolean()) {
+            return it->dump();
+        }
+        return {};
+    }
+
+    // The bridge introduces itself on connect. Version 1 bridges only sent "binary"/"batch" flags, and every
+    // one of them that sent "binary" knew all three frame ops.
+    void process_hello(const json& j) {
+        protocol::capabilities caps;
+        caps.version = protocol::parseNumber(hello_field(j, "version"), 1);
+        caps.binary = (hello_field(j, "binary") == "true");
+        caps.batch = (hello_field(j, "batch") == "true");
+
+        if (j.contains("ops")) {
+            caps.opMask = protocol::parseOps(hello_field(j, "ops"));
+        }
+        else if (caps.binary) {
+            caps.opMask = (1u << protocol::op_rvm) | (1u << protocol::op_wvm) | (1u << protocol::op_rvm_batch);
+        }
+
+        protocol::forEachToken(hello_field(j, "features"), [&](std::string_view feature) {
+            if (feature == "binary") caps.binary = true;
+            else if (feature == "batch") caps.batch = true;
+            else if (feature == "compress") caps.compression = true;
+            else if (feature == "subscribe") caps.subscriptions = true;
+            });
+
+        caps.maxFrame = protocol::parseNumber(hello_field(j, "max_frame"), caps.maxFrame);
+        caps.pointerSize = protocol::parseNumber(hello_field(j, "pointer_size"), caps.pointerSize);
+        caps.window = protocol::parseNumber(hello_field(j, "window"), 0);
+
+        // a bridge that kept running across the drop sends back the token it got, and what it has attached
+        Attachment attachment;
+        std::string token = hello_field(j, "session");
+        attachment.resumed = !token.empty() && token == session_token;
+        attachment.pid = protocol::parseNumber(hello_field(j, "pid"), 0);
+        std::string base = hello_field(j, "base");
+        std::from_chars(base.data(), base.data() + base.size(), attachment.base, 16);
+
+        caps.subscriptions = caps.subscriptions && caps.hasOp(protocol::op_subscribe) && caps.hasOp(protocol::op_unsubscribe);
+
+        std::string ops;
+        for (uint8_t op : protocol::knownOps) {
+            if (caps.hasOp(op)) {
+                ops += (ops.empty() ? "" : ",") + std::string(protocol::opName(op));
+            }
+        }
+
+        logger::addLog("[Bridge] Hello, protocol v" + std::to_string(caps.version) +
+            ", ops: " + (ops.empty() ? "json only" : ops) +
+            ", batching: " + (caps.batch ? "yes" : "no") +
+            ", max frame: " + std::to_string(caps.maxFrame) +
+            ", pointer size: " + std::to_string(caps.pointerSize));
+
+        // answer before switching batching on, the bridge only coalesces replies once it has the ack
+        if (caps.version >= 2) {
+            json ack;
+            ack["type"] = "hello_ack";
+            ack["version"] = std::to_string(protocol::version);
+            ack["ops"] = protocol::supportedOps();
+            ack["features"] = "binary,batch,subscribe,delta,compress";
+            ack["max_frame"] = std::to_string(MAX_INCOMING_FRAME);
+            ack["compress_min"] = std::to_string(COMPRESS_THRESHOLD);
+            ack["session"] = session_token;
+            send(ack.dump());
+        }
+        else if (caps.batch) {
+            send(R"({"type":"hello","batch":"true"})");
+        }
+
+        set_session(caps);
+        finish_resume(attachment.resumed);
+
+        if (attachment.resumed || attachment.pid) {
+            logger::addLog(std::string("[Bridge] ") + (attachment.resumed ? "Session resumed" : "New session") +
+                ", bridge has PID " + std::to_string(attachment.pid) + " attached");
+        }
+
+        std::lock_guard<std::mutex> lock(session_mutex);
+        attachment.session = session_serial;
+        session_attachment = attachment;
+    }
+
+    // Messages without a request_id are rare (hello, bridge notices), these get the full parse
+    void process_unsolicited(std::string_view message) {
+        try {
+            auto j = json::parse(message);
+
+            if (j.value("type", "") == "hello") {
+                process_hello(j);
+            }
+        }
+        catch (const std::exception& e) {
+            logger::addLog("[Bridge] Error processing message: " + std::string(e.what()));
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (!mailbox_capacity) {
+            return;
+        }
+
+        if (incoming_messages.size() >= mailbox_capacity) {
+            incoming_messages.pop_front();
+            mailbox_dropped++;
+        }
+        incoming_messages.emplace_back(message);
+    }
+
+    // The bridge may coalesce several response frames into one message
+    void process_binary_message(const uint8_t* data, size_t size) {
+        size_t offset = 0;
+        while (offset < size) {
+            protocol::frameHeader header;
+            const uint8_t* payload = nullptr;
+
+            if (!protocol::parseFrame(data + offset, size - offset, header, payload) ||
+                !(header.flags & (protocol::flag_response | protocol::flag_push))) {
+                logger::addLog("[Bridge] Dropping malformed binary frame (" + std::to_string(size - offset) + " bytes)");
+                return;
+            }
+
+            // the next frame starts after the payload as it came off the wire
+            size_t next = offset + protocol::frameSize(header);
+
+            if ((header.flags & protocol::flag_compressed) && !inflate(header, payload)) {
+                // a request still gets its answer, as a failure
+                header.flags = static_cast<uint8_t>((header.flags & ~protocol::flag_compressed) | protocol::flag_error);
+                header.length = 0;
+                if (header.flags & protocol::flag_push) {
+                    offset = next;
+                    continue;
+                }
+            }
+
+            if (header.flags & protocol::flag_push) {
+                process_push(header, payload);
+            }
+            else {
+                process_binary_response(header, payload);
+            }
+            offset = next;
+        }
+    }
+
+    void process_binary_response(const protocol::frameHeader& header, const uint8_t* payload) {
+        RequestTable::Request request;
+        if (pending_requests.take(header.requestId, request)) {
+            forget_sent(header.requestId);
+            release_credits(1);
+
+            if (request.binary_callback) {
+                bool success = !(header.flags & protocol::flag_error);
+                size_t size = success ? header.length : 0;
+                auto held = hold(payload, size);
+
+                auto callback = std::move(request.binary_callback);
+                completions.post(std::move(request.type), request.timestamp,
+                    [callback = std::move(callback), success, held = std::move(held), size]() {
+                        callback(success, held.data, size);
+                    });
+            }
+        }
+        else {
+            logger::addLog("[Bridge] Received binary response for unknown request ID: " + std::to_string(header.requestId));
+        }
+    }
+
+    // Swaps a compressed payload for its inflated bytes, payload then points into inflate_buffer
+    bool inflate(protocol::frameHeader& header, const uint8_t*& payload) {
+        uint32_t rawLength = 0;
+        if (header.length < sizeof(rawLength)) {
+            logger::addLog("[Bridge] Compressed frame too short");
+            return false;
+        }
+        memcpy(&rawLength, payload, sizeof(rawLength));
+
+        auto started = std::chrono::steady_clock::now();
+        bool inflated = rawLength <= MAX_INCOMING_FRAME;
+        if (inflated) {
+            inflate_buffer.resize(rawLength);
+            inflated = lz::decompress(payload + sizeof(rawLength), header.length - sizeof(rawLength), inflate_buffer.data(), rawLength);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+
+        std::lock_guard<std::mutex> lock(compression_mutex);
+        if (!inflated) {
+            compression_counters.failures++;
+            logger::addLog("[Bridge] Dropping corrupt compressed frame (" + std::to_string(header.length) + " bytes)");
+            return false;
+        }
+
+        compression_counters.frames++;
+        compression_counters.wire_bytes += header.length;
+        compression_counters.raw_bytes += rawLength;
+        compression_counters.inflate_us += static_cast<uint64_t>(elapsed.count());
+
+        header.flags &= ~protocol::flag_compressed;
+        header.length = rawLength;
+        payload = inflate_buffer.data();
+        return true;
+    }
+
+    // Pushes carry no request and take no credit. One for a subscription that's already gone
+    // (unsubscribe still on its way) is dropped quietly. Pushes for one subscription are handed
+    // over in arrival order, a delta only applies on top of the push before it.
+    void process_push(const protocol::frameHeader& header, const uint8_t* payload) {
+        uint32_t sequence = 0;
+        if (header.op != protocol::op_push || header.length < sizeof(sequence)) {
+            logger::addLog("[Bridge] Dropping malformed push frame");
+            return;
+        }
+        memcpy(&sequence, payload, sizeof(sequence));
+
+        bool delta = header.flags & protocol::flag_delta;
+        PushCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(push_mutex);
+            auto it = subscriptions.find(header.requestId);
+            if (it == subscriptions.end()) {
+                return;
+            }
+            callback = it->second;
+
+            (delta ? push_counters.delta : push_counters.full)++;
+            push_counters.bytes += header.length;
+        }
+
+        size_t size = header.length - sizeof(sequence);
+        auto held = hold(payload + sizeof(sequence), size);
+        completions.postOrdered(header.requestId, delta ? "push_delta" : "push", std::chrono::steady_clock::now(),
+            [callback = std::move(callback), sequence, delta, held = std::move(held), size]() {
+                callback(sequence, delta, held.data, size);
+            });
+    }
+
+    void schedule_timeouts() {
+        timeout_timer.expires_after(RequestTable::TICK);
+        timeout_timer.async_wait([this](boost::system::error_code ec) {
+            if (ec || !running) {
+                return;
+            }
+
+            cleanup_stale_requests();
+            schedule_timeouts();
+            });
+    }
+
+public:
+    BridgeServer()
+        : strand(net::make_strand(ioc)), timeout_timer(strand)
+    {
+    }
+
+    void start() {
+        set_window(protocol::parseNumber(environment("IMCLASS_WINDOW", ""), DEFAULT_WINDOW));
+
+        std::random_device random;
+        char token[17];
+        sprintf_s(token, "%08X%08X", random(), random());
+        session_token = token;
+
+        std::string configured = environment("IMCLASS_ENDPOINT", transport::Endpoint::DEFAULT);
+        if (!transport::Endpoint::parse(configured, endpoint)) {
+            logger::addLog("[Bridge] Invalid endpoint " + configured + ", using " + transport::Endpoint::DEFAULT);
+            transport::Endpoint::parse(transport::Endpoint::DEFAULT, endpoint);
+        }
+
+        link = make_transport(endpoint);
+        if (!link) {
+            logger::addLog("[Bridge] No transport for " + endpoint.describe());
+            return;
+        }
+
+        running = true;
+        completions.start();
+
+        if (!link->open(endpoint, make_handlers())) {
+            logger::addLog(std::string("[Bridge] Failed to open ") + link->name() + " transport");
+        }
+        schedule_timeouts();
+
+        server_thread = std::thread([this]() {
+            try {
+                ioc.run();
+            }
+            catch (const std::exception& e) {
+                logger::addLog("[Bridge] Server error: " + std::string(e.what()));
+            }
+            });
+    }
+
+    void stop() {
+        if (running) {
+            logger::addLog("[Bridge] Stopping server");
+            running = false;
+
+            link->close();
+            timeout_timer.cancel();
+            ioc.stop();
+
+            if (server_thread.joinable()) {
+                server_thread.join();
+            }
+
+            completions.stop();
+
+            logger::addLog("[Bridge] Server stopped");
+        }
+    }
+
+    bool is_connected() {
+        return link && link->is_connected();
+    }
+
+    // Runs task on the server thread once delay has passed
+    void defer(std::chrono::microseconds delay, std::function<void()> task) {
+        auto timer = std::make_shared<net::steady_timer>(strand, delay);
+        timer->async_wait([timer, task = std::move(task)](boost::system::error_code ec) {
+            if (!ec) {
+                task();
+            }
+            });
+    }
+
+    // True when the connected bridge understands this frame op
+    bool supports(uint8_t op) const {
+        return op < 32 && (session_ops.load() & (1u << op));
+    }
+
+    // Largest payload that fits in one frame this session, 0 without binary frames
+    uint32_t max_payload() const {
+        return session_max_payload;
+    }
+
+    // Maximum requests on the wire at once, the rest queue locally. Takes effect immediately.
+    void set_window(uint32_t size) {
+        {
+            std::lock_guard<std::mutex> lock(flow_mutex);
+            window = (std::max)(size, 1u);
+        }
+        release_credits(0);
+    }
+
+    FlowStats flow_stats() {
+        std::lock_guard<std::mutex> lock(flow_mutex);
+        FlowStats stats = flow_counters;
+        stats.window = effective_window();
+        stats.in_flight = in_flight;
+        stats.queued = backlog_size;
+        for (int priority = 0; priority < priority_count; priority++) {
+            stats.queued_by_priority[priority] = backlog[priority].size();
+        }
+        return stats;
+    }
+
+    protocol::capabilities session() {
+        std::lock_guard<std::mutex> lock(session_mutex);
+        return session_caps;
+    }
+
+    // Whether this session's bridge pushes subscribed ranges
+    bool can_subscribe() const {
+        return session_push;
+    }
+
+    // Changes whenever the session does, a subscription made under an older serial no longer exists
+    uint64_t session_id() const {
+        return session_serial;
+    }
+
+    Attachment attachment() {
+        std::lock_guard<std::mutex> lock(session_mutex);
+        return session_attachment;
+    }
+
+    // Asks the bridge to re-read the range every interval and push it whenever it changed, the first
+    // push comes right away. Pushes run on a completion worker and may arrive out of order, the sequence
+    // tells which is newest. done reports whether the bridge took it. Returns the subscription id,
+    // 0 if the session can't push.
+    uint32_t subscribe(uint64_t address, uint32_t size, std::chrono::milliseconds interval, PushCallback on_push,
+        std::function<void(bool)> done = nullptr) {
+        if (!can_subscribe()) {
+            return 0;
+        }
+
+        uint32_t id;
+        {
+            std::lock_guard<std::mutex> lock(push_mutex);
+            id = next_subscription++;
+            subscriptions[id] = std::move(on_push);
+        }
+
+        protocol::subscribeRequest request{ id, size, static_cast<uint32_t>(interval.count()) };
+        uint32_t sent = send_binary_request(protocol::op_subscribe, address, sizeof(request), &request, sizeof(request),
+            [done = std::move(done)](bool success, const uint8_t*, size_t) {
+                if (done) {
+                    done(success);
+                }
+            }, priority_interactive);
+
+        if (!sent) {
+            std::lock_guard<std::mutex> lock(push_mutex);
+            subscriptions.erase(id);
+            return 0;
+        }
+        return id;
+    }
+
+    // Pushes stop being delivered right away, whatever is still on the wire is dropped
+    void unsubscribe(uint32_t id) {
+        {
+            std::lock_guard<std::mutex> lock(push_mutex);
+            if (!subscriptions.erase(id)) {
+                return;
+            }
+        }
+
+        send_binary_request(protocol::op_unsubscribe, 0, sizeof(id), &id, sizeof(id), nullptr);
+    }
+
+    // The next push for this subscription carries the whole range, for when a delta can't be applied
+    void resync(uint32_t id) {
+        {
+            std::lock_guard<std::mutex> lock(push_mutex);
+            if (!subscriptions.count(id)) {
+                return;
+            }
+            push_counters.resyncs++;
+        }
+
+        send_binary_request(protocol::op_resync, 0, sizeof(id), &id, sizeof(id), nullptr, priority_interactive);
+    }
+
+    CompressionStats compression_stats() {
+        std::lock_guard<std::mutex> lock(compression_mutex);
+        return compression_counters;
+    }
+
+    PushStats push_stats() {
+        std::lock_guard<std::mutex> lock(push_mutex);
+        return push_counters;
+    }
+
+    const char* transport_name() const {
+        return link ? link->name() : "none";
+    }
+
+    // Never blocks, the message is written from the transport's thread
+    void send(std::string message) {
+        transport::Message outgoing;
+        outgoing.text = std::move(message);
+        queue_message(std::move(outgoing));
+    }
+
+    // The callback runs on a completion worker, the view is only valid for the duration of the call.
+    // A request still queued after `deadline` (0 = none) is dropped instead of sent.
+    uint32_t send_request(const std::string& type, const json& data,
+        std::function<void(std::string_view)> callback,
+        requestPriority priority = priority_normal, std::chrono::milliseconds deadline = {}) {
+
+        RequestTable::Request request;
+        request.type = type;
+        request.timestamp = std::chrono::steady_clock::now();
+        request.callback = std::move(callback);
+
+        uint32_t id = pending_requests.add(std::move(request), REQUEST_TIMEOUT, false);
+        if (!id) {
+            logger::addLog("[Bridge] Request table full, dropping request: " + type);
+            return 0;
+        }
+
+        json msg = data;
+        msg["type"] = type;
+        msg["request_id"] = std::to_string(id);
+
+        transport::Message outgoing;
+        outgoing.text = msg.dump();
+        // a JSON rvm reads like its binary counterpart, safe to send again after a reconnect
+        return dispatch(id, std::move(outgoing), priority, deadline_after(deadline), type == "rvm") ? id : 0;
+    }
+
+    void send_binary(std::vector<uint8_t> frame) {
+        transport::Message outgoing;
+        outgoing.frame = std::move(frame);
+        outgoing.binary = true;
+        queue_message(std::move(outgoing));
+    }
+
+    // Binary counterpart of send_request, the callback receives the raw response payload
+    uint32_t send_binary_request(uint8_t op, uint64_t address, uint32_t length, const void* payload, size_t payload_size,
+        std::function<void(bool, const uint8_t*, size_t)> callback,
+        requestPriority priority = priority_normal, std::chrono::milliseconds deadline = {}) {
+
+        RequestTable::Request request;
+        request.type = protocol::opName(op);
+        request.timestamp = std::chrono::steady_clock::now();
+        request.binary_callback = std::move(callback);
+
+        uint32_t id = pending_requests.add(std::move(request), REQUEST_TIMEOUT, false);
+        if (!id) {
+            logger::addLog("[Bridge] Request table full, dropping request: " + std::string(protocol::opName(op)));
+            return 0;
+        }
+
+        transport::Message outgoing;
+        outgoing.frame = protocol::buildFrame(op, id, address, length, payload, payload_size);
+        outgoing.binary = true;
+        return dispatch(id, std::move(outgoing), priority, deadline_after(deadline), protocol::isReplayable(op)) ? id : 0;
+    }
+
+    // Driven by timeout_timer on the server thread
+    void cleanup_stale_requests() {
+        auto now = std::chrono::steady_clock::now();
+        drop_expired(now);
+        pending_requests.expire(now, expired_requests);
+
+        for (auto& request : expired_requests) {
+            logger::addLog("[Bridge] Request timeout: " + request.type + " (ID: " + std::to_string(request.id) + ")");
+            forget_sent(request.id);
+            fail_request(request);
+        }
+        if (!expired_requests.empty()) {
+            release_credits(static_cast<uint32_t>(expired_requests.size()));
+        }
+        expired_requests.clear();
+    }
+
+    // Per request type callback latency (queue wait, callback time, full round trip)
+    std::unordered_map<std::string, CompletionExecutor::Stats> latency_stats() {
+        return completions.snapshotStats();
+    }
+
+    // Keeps up to capacity unsolicited messages for receive(), the oldest is dropped when full.
+    // 0 (the default) disables the mailbox and clears whatever is queued.
+    void enable_mailbox(size_t capacity) {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        mailbox_capacity = capacity;
+        while (incoming_messages.size() > capacity) {
+            incoming_messages.pop_front();
+        }
+    }
+
+    size_t dropped_messages() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return mailbox_dropped;
+    }
+
+    bool has_message() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        return !incoming_messages.empty();
+    }
+
+    std::string receive() {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (incoming_messages.empty()) return "";
+
+        std::string msg = std::move(incoming_messages.front());
+        incoming_messages.pop_front();
+        return msg;
+    }
+
+    ~BridgeServer() {
+        stop();
+    }
+};
+
+inline BridgeServer g_Bridge;
@@ -4,12 +4,29 @@
 #include <thread>
 #include <atomic>
 #include <unordered_set>
+#include "refresh_scheduler.h"
 
 inline std::chrono::steady_clock::time_point g_LastClassUpdate = std::chrono::steady_clock::now();
+// one memory thread pass, also the fastest a class that keeps changing is refreshed
 inline constexpr std::chrono::milliseconds CLASS_UPDATE_INTERVAL{ 16 };
+// how long a refresh may wait in the bridge backlog before it's stale
+inline constexpr std::chrono::milliseconds CLASS_READ_DEADLINE{ 100 };
+inline constexpr std::chrono::milliseconds PREVIEW_READ_DEADLINE{ 50 };
+// what's on screen backs off no further than this even when it never changes
+inline constexpr std::chrono::milliseconds VISIBLE_MAX_INTERVAL{ 100 };
+// classes that aren't drawn are only kept roughly current
+inline constexpr std::chrono::milliseconds BACKGROUND_REFRESH_INTERVAL{ 1000 };
+inline constexpr std::chrono::milliseconds BACKGROUND_READ_DEADLINE{ 500 };
+// bytes read past either end of the rows on screen, so scrolling finds them already cached
+inline constexpr int VISIBLE_MARGIN = 512;
+// pointer targets prefetched per memory thread pass
+inline constexpr size_t PREFETCH_BUDGET = 128;
+// time per memory thread pass spent walking exports
+inline constexpr std::chrono::milliseconds EXPORT_STEP_BUDGET{ 8 };
 
 inline std::thread g_MemoryReadThread;
 inline std::atomic<bool> g_MemoryThreadRunning{ false };
+inline RefreshScheduler g_RefreshScheduler{ CLASS_UPDATE_INTERVAL };
 
 namespace ui {
 	extern std::string toHexString(uintptr_t address, int width);
@@ -127,6 +144,18 @@ inline bool g_HoveringPointer = false;
 inline bool g_InPopup = false;
 inline size_t g_SelectedClass = 0;
 
+// The bytes the UI drew last frame. drawNodes adds to g_FrameVisible as it goes (UI thread only),
+// publishVisibility hands the finished set to the memory thread.
+inline std::mutex g_VisibleMutex;
+inline std::vector<RefreshScheduler::Region> g_VisibleRegions;
+inline std::vector<RefreshScheduler::Region> g_FrameVisible;
+
+inline void publishVisibility() {
+	std::lock_guard<std::mutex> lock(g_VisibleMutex);
+	g_VisibleRegions.swap(g_FrameVisible);
+	g_FrameVisible.clear();
+}
+
 class nodeBase {
 public:
 	char name[64];
@@ -167,6 +196,8 @@ public:
 	std::vector<float> totalHeight;
 	size_t lastNodeCount = 0;
 	size_t lastTypeHash = 0;
+	// refreshes per second, 0 lets the scheduler follow how often the class changes
+	int refreshRate = 0;
 
 	uClass(int nodeCount, bool incrementCounter = true) {
 		size = 0;
@@ -245,60 +276,96 @@ inline std::vector<uClass> g_Classes = { uClass(50) };
 
 
 inline void MemoryReadThreadFunc() {
+	uint64_t helloSeen = 0;
+
 	while (g_MemoryThreadRunning) {
 		auto now = std::chrono::steady_clock::now();
 
+		// every hello (reconnect, bridge reloaded) checks the attached process is still ours
+		uint64_t hello = g_Bridge.attachment().session;
+		if (hello != helloSeen) {
+			helloSeen = hello;
+			mem::resumeSession();
+		}
+
 		if (mem::activeProcess) {
-			// Collect all addresses that need reading
-			std::vector<std::pair<uintptr_t, size_t>> read_requests;
+			mem::gatherExports(EXPORT_STEP_BUDGET);
+		}
 
-			for (auto& uClass : g_Classes) {
-				if (uClass.address != 0 && uClass.size > 0) {
-					read_requests.push_back({ uClass.address, uClass.size });
-					logger::addLog("[MemThread] Class addr: 0x" + std::to_string(uClass.address) + " size: " + std::to_string(uClass.size));
-				}
+		if (mem::activeProcess) {
+			// What was on screen last frame is refreshed at full rate, the open classes nobody is
+			// looking at in the background
+			std::vector<RefreshScheduler::Region> regions;
+			{
+				std::lock_guard<std::mutex> lock(g_VisibleMutex);
+				regions = g_VisibleRegions;
 			}
 
-			// Add preview class if it has an address
-			if (g_PreviewClass.address != 0 && g_PreviewClass.size > 0) {
-				read_requests.push_back({ g_PreviewClass.address, g_PreviewClass.size });
+			std::vector<readRange> wanted;
+			for (auto& region : regions) {
+				wanted.push_back({ region.address, region.size });
 			}
 
-			logger::addLog("[MemThread] Reading " + std::to_string(read_requests.size()) + " classes");
-
-			// Clear old snapshots that are no longer needed
-			{
-				std::lock_guard<std::mutex> lock(mem::g_MemoryMutex);
-				std::unordered_set<uintptr_t> active_addresses;
-				for (auto& [addr, size] : read_requests) {
-					active_addresses.insert(addr);
+			for (auto& uClass : g_Classes) {
+				if (uClass.address == 0 || uClass.size == 0) {
+					continue;
 				}
 
-				// Remove stale entries
-				for (auto it = mem::g_MemorySnapshots.begin(); it != mem::g_MemorySnapshots.end();) {
-					if (active_addresses.find(it->first) == active_addresses.end()) {
-						logger::addLog("[MemThread] Removing stale cache for: 0x" + std::to_string(it->first));
-						it = mem::g_MemorySnapshots.erase(it);
-					}
-					else {
-						++it;
-					}
+				bool drawn = std::any_of(wanted.begin(), wanted.end(), [&uClass](const readRange& range) {
+					return range.address < uClass.address + uClass.size && uClass.address < range.address + range.size;
+				});
+				if (!drawn) {
+					regions.push_back({ uClass.address, uClass.size, priority_background, BACKGROUND_REFRESH_INTERVAL });
 				}
 			}
 
-			// Read memory for all classes - USE BLOCKING READ
-			for (auto& [addr, size] : read_requests) {
-				std::vector<uint8_t> buffer(size);
-				if (mem::read_blocking(addr, buffer.data(), size)) {
-					std::lock_guard<std::mutex> lock(mem::g_MemoryMutex);
-					mem::g_MemorySnapshots[addr] = std::move(buffer);
-					logger::addLog("[MemThread] Updated cache for: 0x" + std::to_string(addr) + " (" + std::to_string(size) + " bytes)");
+			// Visible ranges the bridge pushes keep their snapshot current on their own, only the rest is polled
+			mem::syncSubscriptions(wanted, CLASS_UPDATE_INTERVAL);
+			std::erase_if(regions, [](const RefreshScheduler::Region& region) { return mem::isPushed(region.address, region.size); });
+
+			// Only what's due and fits the budget goes out this pass
+			std::vector<readRange> ranges;
+			std::vector<readRange> previewRanges;
+			std::vector<readRange> backgroundRanges;
+			for (auto& region : g_RefreshScheduler.schedule(regions, now)) {
+				auto& batch = region.priority == priority_interactive ? ranges : region.priority == priority_preview ? previewRanges : backgroundRanges;
+				batch.push_back({ region.address, region.size });
+			}
+
+			// All batches are in flight together, a refresh nobody got to before its deadline is
+			// skipped, the next pass asks again. What comes back lands in the page cache on its own,
+			// the scheduler only looks at whether it changed.
+			auto classesFuture = mem::readBatchAsync(std::move(ranges), priority_interactive, CLASS_READ_DEADLINE);
+			auto previewFuture = mem::readBatchAsync(std::move(previewRanges), priority_preview, PREVIEW_READ_DEADLINE);
+			auto backgroundFuture = mem::readBatchAsync(std::move(backgroundRanges), priority_background, BACKGROUND_READ_DEADLINE);
+
+			size_t prefetchBudget = PREFETCH_BUDGET;
+			for (auto* future : { &classesFuture, &previewFuture, &backgroundFuture }) {
+				std::vector<readRange> results;
+				if (!mem::waitResult(*future, std::chrono::milliseconds(100), results)) {
+					continue;
 				}
-				else {
-					logger::addLog("[MemThread] FAILED to read: 0x" + std::to_string(addr));
+
+				auto completed = std::chrono::steady_clock::now();
+				for (auto& range : results) {
+					if (range.success) {
+						g_RefreshScheduler.report(range.address, range.size, range.data.data(), range.data.size(), completed);
+
+						// what these bytes point at is what gets hovered next
+						if (future != &backgroundFuture) {
+							prefetchBudget -= mem::prefetchTargets(range.data.data(), range.data.size(), prefetchBudget);
+						}
+					}
 				}
 			}
 		}
+		else {
+			// nothing to push for without a process
+			mem::syncSubscriptions({}, CLASS_UPDATE_INTERVAL);
+		}
+
+		// Hand the UI what this pass read (and whatever pushes came in meanwhile) as one new generation
+		mem::g_MemoryCache.publish();
 
 		g_LastClassUpdate = now;
 
@@ -791,6 +858,7 @@ inline void uClass::drawHexNumber(int i, uintptr_t num, uintptr_t* ptrOut) {
 			toDraw = "[heap] " + targetAddress;
 		}
 		else {
+			std::lock_guard<std::mutex> lock(mem::g_ExportMutex);
 			auto exportIt = mem::g_ExportMap.find(num);
 			if (exportIt != mem::g_ExportMap.end()) {
 				color = ImColor(0, 255, 0);
@@ -1265,25 +1333,6 @@ inline void uClass::recalculateHeights() {
 }
 
 inline void uClass::drawNodes() {
-	// Copy memory snapshot from background thread
-	bool foundCache = false;
-	{
-		std::lock_guard<std::mutex> lock(mem::g_MemoryMutex);
-		auto it = mem::g_MemorySnapshots.find(this->address);
-		if (it != mem::g_MemorySnapshots.end() && it->second.size() == this->size) {
-			memcpy(this->data, it->second.data(), this->size);
-			foundCache = true;
-		}
-	}
-
-	// ADD THIS - log once every 60 frames
-	static int frameCounter = 0;
-	if (frameCounter++ % 60 == 0) {
-		logger::addLog("[DrawNodes] Cache " + std::string(foundCache ? "FOUND" : "NOT FOUND") +
-			" for 0x" + std::to_string(this->address) +
-			" size: " + std::to_string(this->size));
-	}
-
 	ImVec2 parentSize = ImGui::GetContentRegionAvail();
 
 	uintptr_t clickedPointer = 0;
@@ -1327,6 +1376,36 @@ inline void uClass::drawNodes() {
 		counter += nodes[i].size;
 	}
 
+	int rowsEnd = counter;
+	for (int i = startIdx; i < endIdx; i++) {
+		rowsEnd += nodes[i].size;
+	}
+	rowsEnd = (std::min)(rowsEnd, static_cast<int>(this->size));
+
+	// Copy the rows on screen out of the generation pinned for this frame, the rest of the class isn't
+	// necessarily read at all
+	bool foundCache = rowsEnd > counter &&
+		mem::readCached(this->address + counter, this->data + counter, rowsEnd - counter) == MemoryCache::cache_hit;
+
+	// ADD THIS - log once every 60 frames
+	static int frameCounter = 0;
+	if (frameCounter++ % 60 == 0) {
+		logger::addLog("[DrawNodes] Cache " + std::string(foundCache ? "FOUND" : "NOT FOUND") +
+			" for 0x" + std::to_string(this->address) +
+			" size: " + std::to_string(this->size));
+	}
+
+	// Tell the memory thread which bytes these rows show, give or take a margin for scrolling. Both ends
+	// snap to VISIBLE_MARGIN steps so scrolling a few rows keeps the same region and its refresh history.
+	int visibleBegin = (std::max)(counter - VISIBLE_MARGIN, 0) / VISIBLE_MARGIN * VISIBLE_MARGIN;
+	int visibleEnd = (rowsEnd + 2 * VISIBLE_MARGIN - 1) / VISIBLE_MARGIN * VISIBLE_MARGIN;
+	visibleEnd = (std::min)(visibleEnd, static_cast<int>(this->size));
+	if (this->address && visibleEnd > visibleBegin) {
+		auto pinned = refreshRate > 0 ? std::chrono::milliseconds(1000 / refreshRate) : std::chrono::milliseconds{};
+		g_FrameVisible.push_back({ this->address + visibleBegin, static_cast<uintptr_t>(visibleEnd - visibleBegin),
+			(this == &g_PreviewClass) ? priority_preview : priority_interactive, pinned, VISIBLE_MAX_INTERVAL });
+	}
+
 	for (int i = startIdx; i < endIdx; i++) {
 		auto& node = nodes[i];
 
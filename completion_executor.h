@@ -0,0 +1,228 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "logging.h"
+
+// Runs response callbacks off the network thread. Each worker owns an intrusive lock-free MPSC queue
+// (Vyukov style), posting is a pointer exchange plus a wake, so the reader never waits on a callback
+// and callbacks never run while a transport lock is held. Tasks are spread round-robin, there is no
+// ordering between tasks on different workers unless they're posted with the same key.
+class CompletionExecutor {
+public:
+    // Per request type latency, all times in microseconds
+    struct Stats {
+        uint64_t count = 0;
+        uint64_t totalQueueUs = 0;      // posted -> picked up by a worker
+        uint64_t maxQueueUs = 0;
+        uint64_t totalRunUs = 0;        // time spent inside the callback
+        uint64_t maxRunUs = 0;
+        uint64_t totalRoundTripUs = 0;  // request sent -> callback finished
+        uint64_t maxRoundTripUs = 0;
+    };
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Node {
+        std::atomic<Node*> next{ nullptr };
+        std::string tag;
+        clock::time_point issued;
+        clock::time_point posted;
+        std::function<void()> task;
+    };
+
+    struct Worker {
+        std::atomic<Node*> head;
+        Node* tail;
+        Node stub;
+        std::atomic<uint32_t> signal{ 0 };
+        std::thread thread;
+
+        Worker() : head(&stub), tail(&stub) {}
+
+        ~Worker() {
+            while (Node* node = pop()) {
+                delete node;
+            }
+        }
+
+        void push(Node* node) {
+            node->next.store(nullptr, std::memory_order_relaxed);
+            Node* prev = head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        // Consumer side, only ever called from the worker thread. May return null while a push is
+        // half done, the producer bumps signal afterwards so the worker comes back for it.
+        Node* pop() {
+            Node* first = tail;
+            Node* next = first->next.load(std::memory_order_acquire);
+
+            if (first == &stub) {
+                if (!next) {
+                    return nullptr;
+                }
+                tail = next;
+                first = next;
+                next = next->next.load(std::memory_order_acquire);
+            }
+
+            if (next) {
+                tail = next;
+                return first;
+            }
+
+            if (first != head.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+
+            push(&stub);
+            next = first->next.load(std::memory_order_acquire);
+            if (next) {
+                tail = next;
+                return first;
+            }
+            return nullptr;
+        }
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<uint32_t> nextWorker{ 0 };
+    std::atomic<bool> running{ false };
+
+    std::mutex statsMutex;
+    std::unordered_map<std::string, Stats> stats;
+
+    static uint64_t micros(clock::duration duration) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    }
+
+    void record(const Node& node, clock::time_point started, clock::time_point finished) {
+        uint64_t queueUs = micros(started - node.posted);
+        uint64_t runUs = micros(finished - started);
+        uint64_t roundTripUs = micros(finished - node.issued);
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        Stats& entry = stats[node.tag];
+        entry.count++;
+        entry.totalQueueUs += queueUs;
+        entry.maxQueueUs = (std::max)(entry.maxQueueUs, queueUs);
+        entry.totalRunUs += runUs;
+        entry.maxRunUs = (std::max)(entry.maxRunUs, runUs);
+        entry.totalRoundTripUs += roundTripUs;
+        entry.maxRoundTripUs = (std::max)(entry.maxRoundTripUs, roundTripUs);
+    }
+
+    void execute(Node* node) {
+        auto started = clock::now();
+        try {
+            node->task();
+        }
+        catch (const std::exception& e) {
+            logger::addLog("[Executor] " + node->tag + " callback threw: " + std::string(e.what()));
+        }
+        record(*node, started, clock::now());
+        delete node;
+    }
+
+    void enqueue(uint32_t slot, std::string tag, clock::time_point issued, std::function<void()> task) {
+        Node* node = new Node();
+        node->tag = std::move(tag);
+        node->issued = issued;
+        node->posted = clock::now();
+        node->task = std::move(task);
+
+        if (!running || workers.empty()) {
+            execute(node);
+            return;
+        }
+
+        Worker& worker = *workers[slot % workers.size()];
+        worker.push(node);
+        worker.signal.fetch_add(1, std::memory_order_release);
+        worker.signal.notify_one();
+    }
+
+    void run(Worker& worker) {
+        while (true) {
+            uint32_t seen = worker.signal.load(std::memory_order_acquire);
+
+            while (Node* node = worker.pop()) {
+                execute(node);
+            }
+
+            if (!running) {
+                return;
+            }
+
+            worker.signal.wait(seen, std::memory_order_acquire);
+        }
+    }
+
+public:
+    ~CompletionExecutor() {
+        stop();
+    }
+
+    void start(size_t threadCount = 2) {
+        if (running.exchange(true)) {
+            return;
+        }
+
+        workers.clear();
+        for (size_t i = 0; i < (std::max)(threadCount, size_t(1)); i++) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (auto& worker : workers) {
+            worker->thread = std::thread([this, raw = worker.get()]() { run(*raw); });
+        }
+    }
+
+    // Workers finish what's already queued before exiting
+    void stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+
+        for (auto& worker : workers) {
+            worker->signal.fetch_add(1, std::memory_order_release);
+            worker->signal.notify_one();
+        }
+        for (auto& worker : workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    // issued is when the originating request went out, used for the round trip figure.
+    // Falls back to running the task inline if the executor isn't started.
+    void post(std::string tag, clock::time_point issued, std::function<void()> task) {
+        enqueue(nextWorker.fetch_add(1, std::memory_order_relaxed), std::move(tag), issued, std::move(task));
+    }
+
+    // Tasks posted with the same key all go to one worker, so they run in the order they were posted
+    void postOrdered(uint32_t key, std::string tag, clock::time_point issued, std::function<void()> task) {
+        enqueue(key, std::move(tag), issued, std::move(task));
+    }
+
+    std::unordered_map<std::string, Stats> snapshotStats() {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        return stats;
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.clear();
+    }
+};
@@ -3,6 +3,711 @@ int g_callback_id = 0;
 proc_t g_proc;
 string g_attached_process_name = "";
 
+// Binary frame layout, must match protocol.h on the ImClass side (little-endian)
+// op:u8 flags:u8 reserved:u16 request_id:u32 address:u64 length:u32, then payload
+const uint8 OP_RVM = 1;
+const uint8 OP_WVM = 2;
+const uint8 OP_RVM_BATCH = 3;
+const uint8 OP_SUBSCRIBE = 4;
+const uint8 OP_UNSUBSCRIBE = 5;
+const uint8 OP_PUSH = 6;
+const uint8 OP_RESYNC = 7;
+const uint8 OP_DEREF_CHAIN = 8;
+const uint8 OP_GATHER = 9;
+const uint8 FLAG_RESPONSE = 1;
+const uint8 FLAG_ERROR = 2;
+const uint8 FLAG_PUSH = 4;
+const uint8 FLAG_DELTA = 8;
+const uint8 FLAG_COMPRESSED = 16;
+const uint FRAME_HEADER_SIZE = 20;
+const uint BATCH_RANGE_SIZE = 12;
+const uint SUBSCRIBE_REQUEST_SIZE = 12;
+const uint DELTA_RUN_SIZE = 8;
+const uint CHAIN_REQUEST_SIZE = 8;
+const uint CHAIN_REPLY_SIZE = 8;
+const uint MAX_CHAIN_DEPTH = 32;
+const uint GATHER_REQUEST_SIZE = 20;
+
+// Every queued message is handled each tick, replies are held back and flushed together at the end:
+// binary frames concatenated into one message, JSON replies wrapped in a batch envelope
+// ({"type":"batch",...} header line, then one message per line). Only once ImClass says it understands that.
+// also advertised as the in-flight window, ImClass never has more outstanding than one tick drains
+const uint MAX_MESSAGES_PER_TICK = 256;
+const uint MAX_REPLY_BYTES = 1048576;
+const string BATCH_PREFIX = "{\"type\":\"batch\"";
+
+// Handshake: our hello lists what this script can do, ImClass answers with a hello_ack listing its side.
+// Older ImClass builds answer with a plain hello carrying only "batch".
+const string PROTOCOL_VERSION = "6";
+const string IMCLASS_URL = "ws://localhost:9001";
+const string SUPPORTED_OPS = "rvm,wvm,rvm_batch,subscribe,unsubscribe,resync,deref_chain,gather";
+const uint MAX_FRAME = 1048576;
+
+// Payloads from compress_min bytes up go out LZ compressed when ImClass takes it, in the block layout
+// lz.h decodes. Only kept when it actually saves something.
+const uint LZ_MIN_MATCH = 4;
+const uint LZ_HASH_BITS = 12;
+const uint LZ_MAX_OFFSET = 65535;
+const uint LZ_HASH_PRIME = 2654435761;
+const uint LZ_MAX_RATIO_PERCENT = 90;
+
+uint64 g_compressed_frames = 0;
+uint64 g_compressed_raw = 0;
+uint64 g_compressed_wire = 0;
+
+// Subscriptions: ranges ImClass registered, re-read on our own tick and pushed only when the bytes changed.
+// The tick is the websocket_callback interval. Once ImClass takes deltas, a push after the first only
+// carries the XORed runs that changed since the previous one, see encode_delta.
+const uint TICK_MS = 1;
+const uint MAX_SUBSCRIPTIONS = 256;
+
+class subscription_t
+{
+    uint id;
+    uint64 address;
+    uint size;
+    uint interval_ticks;
+    uint next_tick;
+    uint sequence;
+    bool force_full;
+    array<uint8> last;
+}
+
+array<subscription_t@> g_subscriptions;
+uint g_tick = 0;
+
+// When ImClass goes away the process stays attached and we knock again with backoff (in ticks). The
+// hello carries the session token from the last hello_ack plus the attached process, so ImClass can
+// resume where it stopped instead of starting cold.
+const uint RECONNECT_MIN_TICKS = 250;
+const uint RECONNECT_MAX_TICKS = 5000;
+const uint RECONNECT_TIMEOUT_MS = 200;
+string g_session = "";
+uint g_reconnect_at = 0;
+uint g_reconnect_delay = RECONNECT_MIN_TICKS;
+
+bool g_client_batch = false;
+bool g_client_delta = false;
+bool g_client_compress = false;
+uint g_client_compress_min = 0;
+uint g_client_version = 1;
+uint g_client_max_frame = MAX_FRAME;
+array<uint8> g_reply_frames;
+array<string> g_reply_texts;
+
+uint64 read_le(const string &in msg, uint offset, uint count)
+{
+    uint64 value = 0;
+    for (uint i = 0; i < count; i++) {
+        value |= uint64(uint8(msg[offset + i])) << (8 * i);
+    }
+    return value;
+}
+
+void write_le(array<uint8> &inout out, uint offset, uint64 value, uint count)
+{
+    for (uint i = 0; i < count; i++) {
+        out[offset + i] = uint8((value >> (8 * i)) & 0xFF);
+    }
+}
+
+uint lz_read32(array<uint8> &in data, uint pos)
+{
+    return uint(data[pos]) | (uint(data[pos + 1]) << 8) | (uint(data[pos + 2]) << 16) | (uint(data[pos + 3]) << 24);
+}
+
+void lz_write_length(array<uint8> &inout out, uint length)
+{
+    while (length >= 255) {
+        out.insertLast(255);
+        length -= 255;
+    }
+    out.insertLast(uint8(length));
+}
+
+// One sequence: token, literal length bytes, literals, then the match unless it's the last sequence
+void lz_emit(array<uint8> &inout out, array<uint8> &in input, uint anchor, uint literals, uint offset, uint match_length)
+{
+    uint match_code = match_length >= LZ_MIN_MATCH ? match_length - LZ_MIN_MATCH : 0;
+    uint token = ((literals >= 15 ? 15 : literals) << 4) | (match_code >= 15 ? 15 : match_code);
+    out.insertLast(uint8(token));
+    if (literals >= 15) {
+        lz_write_length(out, literals - 15);
+    }
+    
+    for (uint i = 0; i < literals; i++) {
+        out.insertLast(input[anchor + i]);
+    }
+    
+    if (match_length == 0) {
+        return;
+    }
+    
+    out.insertLast(uint8(offset & 0xFF));
+    out.insertLast(uint8(offset >> 8));
+    if (match_code >= 15) {
+        lz_write_length(out, match_code - 15);
+    }
+}
+
+// Greedy, one hash probe per position, the step grows over stretches without a match so
+// incompressible data doesn't cost a probe per byte
+void lz_compress(array<uint8> &in input, array<uint8> &out output)
+{
+    output.resize(0);
+    uint size = input.length();
+    array<int> table(1 << LZ_HASH_BITS, -1);
+    uint anchor = 0;
+    uint pos = 0;
+    uint misses = 0;
+    
+    while (pos + LZ_MIN_MATCH <= size) {
+        uint sequence = lz_read32(input, pos);
+        uint hash = (uint(sequence * LZ_HASH_PRIME) >> (32 - LZ_HASH_BITS)) & ((1 << LZ_HASH_BITS) - 1);
+        int candidate = table[hash];
+        table[hash] = int(pos);
+        
+        if (candidate < 0 || pos - uint(candidate) > LZ_MAX_OFFSET || lz_read32(input, uint(candidate)) != sequence) {
+            misses++;
+            pos += 1 + (misses >> 6);
+            continue;
+        }
+        
+        uint match = uint(candidate);
+        uint length = LZ_MIN_MATCH;
+        while (pos + length < size && input[match + length] == input[pos + length]) {
+            length++;
+        }
+        
+        lz_emit(output, input, anchor, pos - anchor, pos - match, length);
+        pos += length;
+        anchor = pos;
+        misses = 0;
+    }
+    
+    lz_emit(output, input, anchor, size - anchor, 0, 0);
+}
+
+void send_frame(uint8 op, uint8 flags, uint request_id, uint64 addr, array<uint8> &in payload)
+{
+    queue_frame(op, flags | FLAG_RESPONSE, request_id, addr, payload);
+}
+
+void queue_frame(uint8 op, uint8 flags, uint request_id, uint64 addr, array<uint8> &in raw)
+{
+    array<uint8> payload;
+    if (g_client_compress && raw.length() >= g_client_compress_min) {
+        array<uint8> block;
+        lz_compress(raw, block);
+        
+        if ((block.length() + 4) * 100 <= raw.length() * LZ_MAX_RATIO_PERCENT) {
+            payload.resize(4);
+            write_le(payload, 0, raw.length(), 4);
+            payload.insertAt(4, block);
+            flags |= FLAG_COMPRESSED;
+            
+            g_compressed_frames++;
+            g_compressed_raw += raw.length();
+            g_compressed_wire += payload.length();
+            if (g_compressed_frames % 1000 == 0) {
+                log("[Bridge] Compressed " + g_compressed_frames + " frames, " + g_compressed_raw + " -> " + g_compressed_wire + " bytes");
+            }
+        }
+        else {
+            payload = raw;
+        }
+    }
+    else {
+        payload = raw;
+    }
+    
+    array<uint8> frame(FRAME_HEADER_SIZE);
+    frame[0] = op;
+    frame[1] = flags;
+    write_le(frame, 2, 0, 2);
+    write_le(frame, 4, request_id, 4);
+    write_le(frame, 8, addr, 8);
+    write_le(frame, 16, payload.length(), 4);
+    
+    if (payload.length() > 0) {
+        frame.insertAt(FRAME_HEADER_SIZE, payload);
+    }
+    
+    if (!g_client_batch) {
+        g_ws.send_binary(frame);
+        return;
+    }
+    
+    // keep coalesced messages inside both our limit and what ImClass accepts
+    if (g_reply_frames.length() + frame.length() > g_client_max_frame) {
+        flush_frames();
+    }
+    
+    g_reply_frames.insertAt(g_reply_frames.length(), frame);
+    if (g_reply_frames.length() >= MAX_REPLY_BYTES) {
+        flush_frames();
+    }
+}
+
+void send_text(const string &in json)
+{
+    if (!g_client_batch) {
+        g_ws.send_json(json);
+        return;
+    }
+    
+    g_reply_texts.insertLast(json);
+}
+
+void flush_frames()
+{
+    if (g_reply_frames.length() > 0) {
+        g_ws.send_binary(g_reply_frames);
+        g_reply_frames.resize(0);
+    }
+}
+
+void flush_replies()
+{
+    flush_frames();
+    
+    if (g_reply_texts.length() == 1) {
+        g_ws.send_json(g_reply_texts[0]);
+    }
+    else if (g_reply_texts.length() > 1) {
+        string envelope = BATCH_PREFIX + ",\"count\":\"" + g_reply_texts.length() + "\"}";
+        for (uint i = 0; i < g_reply_texts.length(); i++) {
+            envelope += "\n" + g_reply_texts[i];
+        }
+        g_ws.send_json(envelope);
+    }
+    
+    g_reply_texts.resize(0);
+}
+
+// payload: count:u32 then count * (address:u64 size:u32), reply is length:u32 + bytes per range
+void handle_rvm_batch(const string &in msg, uint payload, uint request_id, uint length)
+{
+    array<uint8> response;
+    
+    // no frame can carry more ranges than this, and 64-bit math keeps a bogus count from wrapping the check
+    uint max_count = (MAX_FRAME - FRAME_HEADER_SIZE - 4) / BATCH_RANGE_SIZE;
+    uint count = length >= 4 ? uint(read_le(msg, payload, 4)) : 0;
+    if (length < 4 || count > max_count || uint64(length) < 4 + uint64(count) * BATCH_RANGE_SIZE) {
+        send_frame(OP_RVM_BATCH, FLAG_ERROR, request_id, 0, response);
+        return;
+    }
+    
+    for (uint i = 0; i < count; i++) {
+        uint entry = payload + 4 + i * BATCH_RANGE_SIZE;
+        uint64 addr = read_le(msg, entry, 8);
+        uint size = uint(read_le(msg, entry + 8, 4));
+        
+        array<uint8> buffer;
+        g_proc.rvm(addr, size, buffer);
+        
+        uint offset = response.length();
+        response.resize(offset + 4);
+        write_le(response, offset, buffer.length(), 4);
+        response.insertAt(response.length(), buffer);
+    }
+    
+    send_frame(OP_RVM_BATCH, 0, request_id, 0, response);
+}
+
+// payload: size:u32 pointer_size:u8 depth:u8 reserved:u16, then depth * offset:i64. Every level adds its
+// offset and reads a pointer there, the last one reads size bytes. Reply is resolved:u32 length:u32,
+// depth * address:u64 (zero past the level that failed), then the bytes once every level was read
+void handle_deref_chain(const string &in msg, uint payload, uint request_id, uint64 addr, uint length)
+{
+    array<uint8> response;
+    
+    uint size = length >= CHAIN_REQUEST_SIZE ? uint(read_le(msg, payload, 4)) : 0;
+    uint pointer_size = length >= CHAIN_REQUEST_SIZE ? uint(read_le(msg, payload + 4, 1)) : 0;
+    uint depth = length >= CHAIN_REQUEST_SIZE ? uint(read_le(msg, payload + 5, 1)) : 0;
+    if (length < CHAIN_REQUEST_SIZE + depth * 8 || depth == 0 || depth > MAX_CHAIN_DEPTH ||
+        (pointer_size != 4 && pointer_size != 8) || size > MAX_REPLY_BYTES) {
+        send_frame(OP_DEREF_CHAIN, FLAG_ERROR, request_id, addr, response);
+        return;
+    }
+    
+    response.resize(CHAIN_REPLY_SIZE + depth * 8);
+    for (uint i = 0; i < response.length(); i++) {
+        response[i] = 0;
+    }
+    
+    uint resolved = 0;
+    uint64 current = addr;
+    array<uint8> buffer;
+    for (uint level = 0; level < depth; level++) {
+        // offsets are signed, wrapping unsigned addition does the right thing
+        current += read_le(msg, payload + CHAIN_REQUEST_SIZE + level * 8, 8);
+        if (pointer_size == 4) {
+            current &= 0xFFFFFFFF;
+        }
+        write_le(response, CHAIN_REPLY_SIZE + level * 8, current, 8);
+        
+        uint want = (level + 1 == depth) ? size : pointer_size;
+        g_proc.rvm(current, want, buffer);
+        if (buffer.length() < want) {
+            break;
+        }
+        resolved++;
+        
+        if (level + 1 < depth) {
+            current = 0;
+            for (uint i = 0; i < pointer_size; i++) {
+                current |= uint64(buffer[i]) << (8 * i);
+            }
+        }
+    }
+    
+    write_le(response, 0, resolved, 4);
+    if (resolved == depth) {
+        buffer.resize(size);
+        write_le(response, 4, size, 4);
+        response.insertAt(response.length(), buffer);
+    }
+    
+    send_frame(OP_DEREF_CHAIN, 0, request_id, addr, response);
+}
+
+// payload: count:u32 stride:u32 offset:i32 size:u32 pointer_size:u8 reserved:u8[3]. Reads count pointers
+// stride bytes apart from addr, then size bytes at every non-null pointer + offset. Reply is
+// count * pointer:u64, count * valid:u8, then count * size bytes (zeroed where not valid)
+void handle_gather(const string &in msg, uint payload, uint request_id, uint64 addr, uint length)
+{
+    array<uint8> response;
+    
+    if (length < GATHER_REQUEST_SIZE) {
+        send_frame(OP_GATHER, FLAG_ERROR, request_id, addr, response);
+        return;
+    }
+    
+    uint count = uint(read_le(msg, payload, 4));
+    uint stride = uint(read_le(msg, payload + 4, 4));
+    int offset = int(read_le(msg, payload + 8, 4));
+    uint size = uint(read_le(msg, payload + 12, 4));
+    uint pointer_size = uint(read_le(msg, payload + 16, 1));
+    
+    // 64-bit math, a bogus count can't wrap the limit checks
+    uint64 table_bytes = uint64(count) * stride;
+    uint64 reply_bytes = uint64(count) * (9 + size);
+    if ((pointer_size != 4 && pointer_size != 8) || stride < pointer_size ||
+        table_bytes > MAX_REPLY_BYTES || reply_bytes > MAX_REPLY_BYTES) {
+        send_frame(OP_GATHER, FLAG_ERROR, request_id, addr, response);
+        return;
+    }
+    
+    array<uint8> table;
+    g_proc.rvm(addr, uint(table_bytes), table);
+    if (table.length() < table_bytes) {
+        send_frame(OP_GATHER, FLAG_ERROR, request_id, addr, response);
+        return;
+    }
+    
+    response.resize(uint(reply_bytes));
+    for (uint i = 0; i < response.length(); i++) {
+        response[i] = 0;
+    }
+    
+    uint flags = count * 8;
+    uint blocks = count * 9;
+    array<uint8> block;
+    for (uint i = 0; i < count; i++) {
+        uint64 pointer = 0;
+        for (uint b = 0; b < pointer_size; b++) {
+            pointer |= uint64(table[i * stride + b]) << (8 * b);
+        }
+        write_le(response, i * 8, pointer, 8);
+        
+        if (pointer == 0) {
+            continue;
+        }
+        
+        uint64 target = pointer + uint64(int64(offset));
+        if (pointer_size == 4) {
+            target &= 0xFFFFFFFF;
+        }
+        
+        g_proc.rvm(target, size, block);
+        if (block.length() < size) {
+            continue;
+        }
+        
+        response[flags + i] = 1;
+        uint at = blocks + i * size;
+        for (uint b = 0; b < size; b++) {
+            response[at + b] = block[b];
+        }
+    }
+    
+    send_frame(OP_GATHER, 0, request_id, addr, response);
+}
+
+int find_subscription(uint id)
+{
+    for (uint i = 0; i < g_subscriptions.length(); i++) {
+        if (g_subscriptions[i].id == id) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+// payload: subscription_id:u32 size:u32 interval_ms:u32, the range starts at the frame address
+void handle_subscribe(const string &in msg, uint payload, uint request_id, uint64 addr, uint length)
+{
+    array<uint8> empty;
+    
+    if (length < SUBSCRIBE_REQUEST_SIZE) {
+        send_frame(OP_SUBSCRIBE, FLAG_ERROR, request_id, addr, empty);
+        return;
+    }
+    
+    uint id = uint(read_le(msg, payload, 4));
+    uint size = uint(read_le(msg, payload + 4, 4));
+    uint interval = uint(read_le(msg, payload + 8, 4));
+    
+    // a push is one frame, it has to fit what ImClass accepts
+    bool fits = size > 0 && FRAME_HEADER_SIZE + 4 + size <= g_client_max_frame;
+    int existing = find_subscription(id);
+    if (!fits || (existing < 0 && g_subscriptions.length() >= MAX_SUBSCRIPTIONS)) {
+        send_frame(OP_SUBSCRIBE, FLAG_ERROR, request_id, addr, empty);
+        return;
+    }
+    
+    subscription_t sub;
+    sub.id = id;
+    sub.address = addr;
+    sub.size = size;
+    sub.interval_ticks = interval > TICK_MS ? interval / TICK_MS : 1;
+    sub.next_tick = g_tick;
+    sub.sequence = 0;
+    sub.force_full = true;
+    
+    if (existing >= 0) {
+        @g_subscriptions[existing] = sub;
+    }
+    else {
+        g_subscriptions.insertLast(sub);
+    }
+    
+    send_frame(OP_SUBSCRIBE, 0, request_id, addr, empty);
+}
+
+void handle_unsubscribe(const string &in msg, uint payload, uint request_id, uint length)
+{
+    array<uint8> empty;
+    
+    if (length < 4) {
+        send_frame(OP_UNSUBSCRIBE, FLAG_ERROR, request_id, 0, empty);
+        return;
+    }
+    
+    int index = find_subscription(uint(read_le(msg, payload, 4)));
+    if (index >= 0) {
+        g_subscriptions.removeAt(uint(index));
+    }
+    
+    send_frame(OP_UNSUBSCRIBE, 0, request_id, 0, empty);
+}
+
+// ImClass couldn't apply a delta, the next push for this subscription carries the whole range
+void handle_resync(const string &in msg, uint payload, uint request_id, uint length)
+{
+    array<uint8> empty;
+    int index = length >= 4 ? find_subscription(uint(read_le(msg, payload, 4))) : -1;
+    
+    if (index < 0) {
+        send_frame(OP_RESYNC, FLAG_ERROR, request_id, 0, empty);
+        return;
+    }
+    
+    g_subscriptions[index].force_full = true;
+    g_subscriptions[index].next_tick = g_tick;
+    send_frame(OP_RESYNC, 0, request_id, 0, empty);
+}
+
+// XOR of current against previous as runs of skip:u32 count:u32 then count XORed bytes. Unchanged gaps
+// shorter than a run header stay inside the run. False once the delta isn't smaller than the range.
+bool encode_delta(array<uint8> &in previous, array<uint8> &in current, array<uint8> &out delta)
+{
+    delta.resize(0);
+    uint size = current.length();
+    uint pos = 0;
+    
+    while (pos < size) {
+        uint run_start = pos;
+        while (pos < size && current[pos] == previous[pos]) {
+            pos++;
+        }
+        if (pos == size) {
+            break;
+        }
+        
+        uint literal_start = pos;
+        uint literal_end = pos;
+        while (pos < size) {
+            if (current[pos] != previous[pos]) {
+                pos++;
+                literal_end = pos;
+                continue;
+            }
+            
+            uint gap = pos;
+            while (gap < size && current[gap] == previous[gap]) {
+                gap++;
+            }
+            if (gap == size || gap - pos >= DELTA_RUN_SIZE) {
+                break;
+            }
+            pos = gap;
+        }
+        pos = literal_end;
+        
+        uint offset = delta.length();
+        uint count = literal_end - literal_start;
+        delta.resize(offset + DELTA_RUN_SIZE + count);
+        write_le(delta, offset, literal_start - run_start, 4);
+        write_le(delta, offset + 4, count, 4);
+        for (uint i = 0; i < count; i++) {
+            delta[offset + DELTA_RUN_SIZE + i] = uint8(current[literal_start + i] ^ previous[literal_start + i]);
+        }
+        
+        if (delta.length() >= size) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// Re-reads every subscription that's due, the first read always goes out
+void refresh_subscriptions()
+{
+    g_tick++;
+    
+    if (!g_proc.alive()) {
+        return;
+    }
+    
+    for (uint i = 0; i < g_subscriptions.length(); i++) {
+        subscription_t@ sub = g_subscriptions[i];
+        if (int(g_tick - sub.next_tick) < 0) {
+            continue;
+        }
+        sub.next_tick = g_tick + sub.interval_ticks;
+        
+        array<uint8> buffer;
+        g_proc.rvm(sub.address, sub.size, buffer);
+        if (buffer.length() < sub.size || (!sub.force_full && buffer == sub.last)) {
+            continue;
+        }
+        
+        array<uint8> delta;
+        bool full = sub.force_full || !g_client_delta || sub.last.length() != buffer.length() ||
+            !encode_delta(sub.last, buffer, delta);
+        
+        sub.last = buffer;
+        sub.sequence++;
+        sub.force_full = false;
+        
+        array<uint8> payload(4);
+        write_le(payload, 0, sub.sequence, 4);
+        payload.insertAt(4, full ? buffer : delta);
+        queue_frame(OP_PUSH, full ? FLAG_PUSH : FLAG_PUSH | FLAG_DELTA, sub.id, sub.address, payload);
+    }
+}
+
+// Handles the frame at offset, returns the offset of the next frame or msg.length() when done
+uint handle_frame(const string &in msg, uint offset)
+{
+    if (msg.length() - offset < FRAME_HEADER_SIZE) {
+        log("[Bridge] Binary frame too short: " + (msg.length() - offset));
+        return msg.length();
+    }
+    
+    uint8 op = uint8(msg[offset]);
+    uint request_id = uint(read_le(msg, offset + 4, 4));
+    uint64 addr = read_le(msg, offset + 8, 8);
+    uint length = uint(read_le(msg, offset + 16, 4));
+    uint payload = offset + FRAME_HEADER_SIZE;
+    
+    // rvm requests only carry the size to read, every other op carries its payload
+    uint next = (op == OP_RVM) ? payload : payload + length;
+    if (next > msg.length()) {
+        log("[Bridge] Truncated binary frame, op: " + op);
+        return msg.length();
+    }
+    
+    array<uint8> empty;
+    
+    if (!g_proc.alive()) {
+        send_frame(op, FLAG_ERROR, request_id, addr, empty);
+        return next;
+    }
+    
+    if (op == OP_RVM) {
+        array<uint8> buffer;
+        g_proc.rvm(addr, length, buffer);
+        send_frame(op, 0, request_id, addr, buffer);
+    }
+    else if (op == OP_WVM) {
+        array<uint8> buffer(length);
+        for (uint i = 0; i < length; i++) {
+            buffer[i] = uint8(msg[payload + i]);
+        }
+        
+        bool success = g_proc.wvm(addr, buffer);
+        send_frame(op, success ? 0 : FLAG_ERROR, request_id, addr, empty);
+    }
+    else if (op == OP_RVM_BATCH) {
+        handle_rvm_batch(msg, payload, request_id, length);
+    }
+    else if (op == OP_SUBSCRIBE) {
+        handle_subscribe(msg, payload, request_id, addr, length);
+    }
+    else if (op == OP_UNSUBSCRIBE) {
+        handle_unsubscribe(msg, payload, request_id, length);
+    }
+    else if (op == OP_RESYNC) {
+        handle_resync(msg, payload, request_id, length);
+    }
+    else if (op == OP_DEREF_CHAIN) {
+        handle_deref_chain(msg, payload, request_id, addr, length);
+    }
+    else if (op == OP_GATHER) {
+        handle_gather(msg, payload, request_id, addr, length);
+    }
+    else {
+        log("[Bridge] Unknown binary op: " + op);
+        send_frame(op, FLAG_ERROR, request_id, addr, empty);
+    }
+    
+    return next;
+}
+
+// ImClass gathers several frames into one binary message, walk all of them
+void handle_binary(const string &in msg)
+{
+    uint offset = 0;
+    while (offset < msg.length()) {
+        offset = handle_frame(msg, offset);
+    }
+}
+
+// IMAGE_FILE_HEADER.Machine of the main image, 0x14C is i386
+bool is_x32_image(uint64 base)
+{
+    uint32 nt_offset = g_proc.ru32(base + 0x3C);
+    if (nt_offset == 0 || nt_offset > 0x1000) {
+        return false;
+    }
+    
+    return g_proc.ru16(base + nt_offset + 4) == 0x14C;
+}
+
 void handle_ref_process(dictionary &in request)
 {
     string request_id;
@@ -23,7 +728,7 @@ void handle_ref_process(dictionary &in request)
         
         string json, err;
         if (json_stringify(response, json, err)) {
-            g_ws.send_json(json);
+            send_text(json);
         }
         return;
     }
@@ -73,7 +778,7 @@ void handle_ref_process(dictionary &in request)
         response.set("base_address", base_str);
         response.set("peb", peb_str);
         response.set("pid", pid_response);
-        response.set("is_x32", "false");
+        response.set("is_x32", is_x32_image(base) ? "true" : "false");
         
         log("[Bridge] PID: " + pid_response);
         log("[Bridge] Base: 0x" + base_str);
@@ -82,7 +787,7 @@ void handle_ref_process(dictionary &in request)
     
     string json, err;
     if (json_stringify(response, json, err)) {
-        g_ws.send_json(json);
+        send_text(json);
     } else {
         log("[Bridge] Failed to stringify response: " + err);
     }
@@ -121,7 +826,7 @@ void handle_rvm(dictionary &in request)
     
     string json, err;
     if (json_stringify(response, json, err)) {
-        g_ws.send_json(json);
+        send_text(json);
     }
 }
 
@@ -160,7 +865,7 @@ void handle_wvm(dictionary &in request)
     
     string json, err;
     if (json_stringify(response, json, err)) {
-        g_ws.send_json(json);
+        send_text(json);
     }
 }
 
@@ -198,7 +903,7 @@ void handle_find_pattern(dictionary &in request)
     
     string json, err;
     if (json_stringify(response, json, err)) {
-        g_ws.send_json(json);
+        send_text(json);
     }
 }
 
@@ -216,7 +921,7 @@ void handle_get_modules(dictionary &in request)
         
         string json, err;
         if (json_stringify(response, json, err)) {
-            g_ws.send_json(json);
+            send_text(json);
         }
         return;
     }
@@ -231,7 +936,7 @@ void handle_get_modules(dictionary &in request)
         
         string json, err;
         if (json_stringify(response, json, err)) {
-            g_ws.send_json(json);
+            send_text(json);
         }
         return;
     }
@@ -244,7 +949,7 @@ void handle_get_modules(dictionary &in request)
         
         string json, err;
         if (json_stringify(response, json, err)) {
-            g_ws.send_json(json);
+            send_text(json);
         }
         return;
     }
@@ -298,63 +1003,185 @@ void handle_get_modules(dictionary &in request)
     
     string json, err;
     if (json_stringify(response, json, err)) {
-        g_ws.send_json(json);
+        send_text(json);
+    }
+}
+
+bool has_token(const string &in list, const string &in token)
+{
+    return ("," + list + ",").findFirst("," + token + ",") >= 0;
+}
+
+void handle_hello_ack(dictionary &in request)
+{
+    string version, features, max_frame;
+    request.get("version", version);
+    request.get("features", features);
+    request.get("max_frame", max_frame);
+    
+    g_client_version = uint(parseUInt(version, 10));
+    g_client_batch = has_token(features, "batch");
+    g_client_delta = has_token(features, "delta");
+    g_client_compress = has_token(features, "compress");
+    
+    string compress_min;
+    request.get("compress_min", compress_min);
+    g_client_compress_min = uint(parseUInt(compress_min, 10));
+    if (g_client_compress_min == 0) {
+        g_client_compress_min = 4096;
+    }
+    
+    uint client_max = uint(parseUInt(max_frame, 10));
+    g_client_max_frame = (client_max > 0 && client_max < MAX_FRAME) ? client_max : MAX_FRAME;
+    
+    request.get("session", g_session);
+    
+    log("[Bridge] ImClass protocol v" + g_client_version + ", batching: " + (g_client_batch ? "enabled" : "disabled") + ", deltas: " + (g_client_delta ? "enabled" : "disabled") + ", compression: " + (g_client_compress ? "from " + g_client_compress_min + " bytes" : "disabled") + ", max frame: " + g_client_max_frame);
+}
+
+// The envelope header is the first line, every following line is one message
+void handle_batch(const string &in msg)
+{
+    int start = msg.findFirst("\n");
+    while (start >= 0) {
+        int end = msg.findFirst("\n", uint(start + 1));
+        uint count = (end < 0) ? msg.length() - uint(start + 1) : uint(end - start - 1);
+        
+        if (count > 0) {
+            handle_text(msg.substr(uint(start + 1), count));
+        }
+        start = end;
+    }
+}
+
+void handle_text(const string &in msg)
+{
+    if (msg.substr(0, BATCH_PREFIX.length()) == BATCH_PREFIX) {
+        handle_batch(msg);
+        return;
     }
+    
+    dictionary d;
+    string err;
+    
+    if (!json_parse(msg, d, err)) {
+        log("[Bridge] JSON parse failed: " + err);
+        return;
+    }
+    
+    string type;
+    d.get("type", type);
+    
+    if (type == "hello") {
+        string batch;
+        d.get("batch", batch);
+        g_client_batch = (batch == "true");
+        log("[Bridge] ImClass hello, batching: " + (g_client_batch ? "enabled" : "disabled"));
+    }
+    else if (type == "hello_ack") {
+        handle_hello_ack(d);
+    }
+    else if (type == "ref_process") {
+        handle_ref_process(d);
+    }
+    else if (type == "rvm") {
+        handle_rvm(d);
+    }
+    else if (type == "wvm") {
+        handle_wvm(d);
+    }
+    else if (type == "get_modules") {
+        handle_get_modules(d);
+    }
+    else if (type == "find_pattern") {
+        handle_find_pattern(d);
+    }
+}
+
+// binary/batch stay for ImClass builds that predate the handshake
+void send_hello()
+{
+    string attached = "";
+    if (g_proc.alive()) {
+        attached = "\",\"pid\":\"" + formatUInt(g_proc.pid(), "", 10) + "\",\"base\":\"" + formatUInt(g_proc.base_address(), "0H", 16);
+    }
+    
+    g_ws.send_json("{\"type\":\"hello\",\"from\":\"perception.cx\",\"version\":\"" + PROTOCOL_VERSION +
+        "\",\"ops\":\"" + SUPPORTED_OPS + "\",\"features\":\"binary,batch,subscribe,compress\",\"max_frame\":\"" + MAX_FRAME +
+        "\",\"pointer_size\":\"8\",\"window\":\"" + MAX_MESSAGES_PER_TICK +
+        "\",\"session\":\"" + g_session + attached +
+        "\",\"binary\":\"true\",\"batch\":\"true\"}");
+    log("[Bridge] Sent hello message");
+}
+
+void reconnect()
+{
+    g_tick++;
+    if (int(g_tick - g_reconnect_at) < 0) {
+        return;
+    }
+    
+    g_ws = ws_connect(IMCLASS_URL, RECONNECT_TIMEOUT_MS);
+    if (!g_ws.is_open()) {
+        g_reconnect_delay = (g_reconnect_delay * 2 < RECONNECT_MAX_TICKS) ? g_reconnect_delay * 2 : RECONNECT_MAX_TICKS;
+        g_reconnect_at = g_tick + g_reconnect_delay;
+        return;
+    }
+    
+    log("[Bridge] Reconnected to ImClass");
+    g_reconnect_delay = RECONNECT_MIN_TICKS;
+    
+    // whatever ImClass can do gets negotiated again
+    g_client_batch = false;
+    g_client_delta = false;
+    g_client_compress = false;
+    g_client_version = 1;
+    g_client_max_frame = MAX_FRAME;
+    send_hello();
 }
 
 void websocket_callback(int id, int data)
 {
     if (!g_ws.is_open()) {
+        reconnect();
         return;
     }
     
     string msg;
-    bool text, closed;
+    bool text = false;
+    bool closed = false;
+    uint handled = 0;
     
-    if (g_ws.poll(msg, text, closed)) {
-        dictionary d;
-        string err;
-        
-        if (!json_parse(msg, d, err)) {
-            log("[Bridge] JSON parse failed: " + err);
-            return;
-        }
-        
-        string type;
-        d.get("type", type);
-        
-        if (type == "ref_process") {
-            handle_ref_process(d);
-        }
-        else if (type == "rvm") {
-            handle_rvm(d);
+    // drain everything that arrived since the last tick, capped so a flood can't stall the host
+    while (handled < MAX_MESSAGES_PER_TICK && !closed && g_ws.poll(msg, text, closed)) {
+        if (!text) {
+            handle_binary(msg);
         }
-        else if (type == "wvm") {
-            handle_wvm(d);
-        }
-        else if (type == "get_modules") {
-            handle_get_modules(d);
-        }
-        else if (type == "find_pattern") {
-            handle_find_pattern(d);
+        else {
+            handle_text(msg);
         }
+        handled++;
     }
     
+    refresh_subscriptions();
+    flush_replies();
+    
     if (closed) {
-        log("[Bridge] Connection closed by server");
+        log("[Bridge] Connection closed by server, reconnecting");
+        g_subscriptions.resize(0);
+        g_reply_frames.resize(0);
+        g_reply_texts.resize(0);
         g_ws.close();
-        if (g_callback_id != 0) {
-            unregister_callback(g_callback_id);
-            g_callback_id = 0;
-        }
+        g_reconnect_delay = RECONNECT_MIN_TICKS;
+        g_reconnect_at = g_tick + g_reconnect_delay;
     }
 }
 
 int main()
 {
-    log("[Bridge] Connecting to ImClass on ws://localhost:9001");
+    log("[Bridge] Connecting to ImClass on " + IMCLASS_URL);
     
-    g_ws = ws_connect("ws://localhost:9001", 5000);
+    g_ws = ws_connect(IMCLASS_URL, 5000);
     
     if (!g_ws.is_open()) {
         log("[Bridge] Connection FAILED!");
@@ -363,10 +1190,9 @@ int main()
     
     log("[Bridge] Connected successfully!");
     
-    g_ws.send_json("{\"type\":\"hello\",\"from\":\"perception.cx\"}");
-    log("[Bridge] Sent hello message");
+    send_hello();
     
-    g_callback_id = register_callback(websocket_callback, 1, 0);
+    g_callback_id = register_callback(websocket_callback, TICK_MS, 0);
     
     return 1;
 }
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Decoder for the block format imclass_server.as compresses large payloads with, the LZ4 block layout.
+// A sequence is a token (literal count in the high nibble, match length minus MIN_MATCH in the low one,
+// 15 in either means extra length bytes follow, each adding up to 255 and 255 meaning another one
+// follows), the literals, then a 2-byte little-endian offset back into the output and the match length
+// bytes. The last sequence carries literals only.
+namespace lz {
+    inline constexpr size_t MIN_MATCH = 4;
+
+    namespace detail {
+        inline bool readLength(const uint8_t* input, size_t size, size_t& position, size_t& length) {
+            if (length != 15) {
+                return true;
+            }
+
+            uint8_t extra;
+            do {
+                if (position >= size) {
+                    return false;
+                }
+                extra = input[position++];
+                length += extra;
+            } while (extra == 255);
+            return true;
+        }
+    }
+
+    // Decodes a block into exactly outSize bytes, false on anything malformed. Never reads or writes
+    // outside the given buffers.
+    inline bool decompress(const uint8_t* input, size_t size, uint8_t* out, size_t outSize) {
+        size_t in = 0;
+        size_t pos = 0;
+
+        while (in < size) {
+            uint8_t token = input[in++];
+
+            size_t literals = token >> 4;
+            if (!detail::readLength(input, size, in, literals) || literals > size - in || literals > outSize - pos) {
+                return false;
+            }
+            memcpy(out + pos, input + in, literals);
+            in += literals;
+            pos += literals;
+
+            if (in == size) {
+                break;
+            }
+
+            if (size - in < 2) {
+                return false;
+            }
+            size_t offset = input[in] | (size_t(input[in + 1]) << 8);
+            in += 2;
+
+            size_t match = token & 15;
+            if (!offset || offset > pos || !detail::readLength(input, size, in, match)) {
+                return false;
+            }
+
+            match += MIN_MATCH;
+            if (match > outSize - pos) {
+                return false;
+            }
+
+            // a match may overlap the bytes it produces (runs), copy forward one byte at a time
+            const uint8_t* from = out + pos - offset;
+            for (size_t i = 0; i < match; i++) {
+                out[pos + i] = from[i];
+            }
+            pos += match;
+        }
+
+        return pos == outSize;
+    }
+}
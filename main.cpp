@@ -1,4 +1,4 @@
-#include <websocket_server.h>
+#include <bridge_server.h>
 #include <Windows.h>
 #include <iostream>
 #include <string>
@@ -22,7 +22,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
     ShowWindow(hwnd, SW_HIDE);
     UpdateWindow(hwnd);
     ui::init(hwnd);
-    g_WebSocketServer.start();
+    g_Bridge.start();
 
     // Start memory reading thread
     g_MemoryThreadRunning = true;
@@ -38,8 +38,6 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
             continue;
         }
 
-        g_WebSocketServer.cleanup_stale_requests();
-
         if (mem::g_NeedsModuleRefresh) {
             mem::g_NeedsModuleRefresh = false;
             mem::getModules();
@@ -49,7 +47,10 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         ImGui_ImplWin32_NewFrame();
         ImGui::NewFrame();
 
+        mem::pinFrame();
         ui::render();
+        mem::unpinFrame();
+        publishVisibility();
 
         ImGui::Render();
         const float clear_color[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
@@ -67,7 +68,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
         g_MemoryReadThread.join();
     }
 
-    g_WebSocketServer.stop();
+    g_Bridge.stop();
 
     ImGui_ImplDX11_Shutdown();
     ImGui_ImplWin32_Shutdown();
@@ -10,7 +10,9 @@
 #include <Psapi.h>
 #include <mutex>
 #include <future>
-#include "websocket_server.h"
+#include "bridge_server.h"
+#include "read_coalescer.h"
+#include "memory_cache.h"
 
 struct processSnapshot {
     std::wstring name;
@@ -63,18 +65,92 @@ struct funcExport
     uintptr_t address;
 };
 
+struct readRange {
+    uintptr_t address;
+    uintptr_t size;
+    std::vector<uint8_t> data;
+    bool success = false;
+};
+
+// Result of a pointer walk, see mem::readPointerChainAsync
+struct pointerChain {
+    std::vector<uintptr_t> addresses;   // per level, where it read (the first resolved + 1 are valid)
+    std::vector<uint8_t> data;          // the bytes at the last level
+    size_t resolved = 0;                // levels that could be read
+    bool success = false;               // every level was read, data holds the bytes
+};
+
+// One element of a gather, see mem::gatherAsync
+struct gatherEntry {
+    uintptr_t pointer = 0;          // the value in the pointer array
+    std::vector<uint8_t> data;      // size bytes at pointer + offset
+    bool valid = false;             // non-null and data could be read
+};
+
 namespace mem {
     inline std::vector<processSnapshot> processes;
     inline HANDLE memHandle;
     inline DWORD g_pid;
+    // image base of the attached process, with the PID what tells it's still the same one after a reconnect
+    inline uintptr_t g_base = 0;
     inline std::vector<moduleInfo> moduleList;
     inline std::unordered_map<uintptr_t, std::string> g_ExportMap;
+    inline std::mutex g_ExportMutex;
     inline bool x32 = false;
 
     inline bool g_NeedsModuleRefresh = false;
-
-    inline std::mutex g_MemoryMutex;
-    inline std::unordered_map<uintptr_t, std::vector<uint8_t>> g_MemorySnapshots;
+    inline std::atomic<bool> g_NeedsExportRefresh{ false };
+
+    // every read that comes back is cached here, see sendRead/sendReads
+    inline MemoryCache g_MemoryCache;
+    // the generation this thread pinned for its frame, reads made while it's set come from it
+    inline thread_local std::shared_ptr<const MemoryCache::Generation> t_FrameGeneration;
+
+    // Export harvesting walks a few modules per memory thread pass so class refreshes keep going
+    // in between, only touched by the memory thread
+    struct exportWalk {
+        std::vector<moduleInfo> modules;
+        size_t next = 0;
+        std::unordered_map<uintptr_t, std::string> exportMap;
+        bool active = false;
+    };
+    inline exportWalk g_ExportWalk;
+
+    // Ranges the bridge keeps current by pushing them, see syncSubscriptions
+    struct subscription {
+        uintptr_t address;
+        uintptr_t size;
+        uint32_t id;
+        uint64_t session;
+        DWORD pid;
+        uint32_t lastSequence = 0;
+        bool pushing = false;   // the bridge took it, pushes keep the snapshot current
+        bool resyncing = false; // a delta didn't fit, waiting for the whole range again
+        std::vector<uint8_t> base;  // the last pushed version, what the next delta applies to
+    };
+    inline std::mutex g_SubscriptionMutex;
+    inline std::vector<subscription> g_Subscriptions;
+
+    // Pattern scans go out as sequential chunks of this size so other requests fit in between
+    inline constexpr uintptr_t PATTERN_CHUNK_SIZE = 4 * 1024 * 1024;
+
+    struct patternScan {
+        uintptr_t next;
+        uintptr_t end;
+        uintptr_t overlap;
+        std::string pattern;
+        std::promise<uintptr_t> promise;
+    };
+
+    // Pointer walks that the bridge can't do itself go level by level, this carries one between reads
+    struct chainWalk {
+        std::vector<int64_t> offsets;
+        uintptr_t size;
+        requestPriority priority;
+        uintptr_t current;
+        pointerChain chain;
+        std::promise<pointerChain> promise;
+    };
 
     bool getProcessList();
     void getModules();
@@ -82,18 +158,88 @@ namespace mem {
     bool isPointer(uintptr_t address, pointerInfo* info);
     bool rttiInfo(uintptr_t address, std::string& out);
     std::vector<funcExport> gatherRemoteExports(uintptr_t moduleBase);
-    void gatherExports();
+    void gatherExports(std::chrono::milliseconds budget);
     uintptr_t getExport(const std::string& moduleName, const std::string& exportName);
 
     uintptr_t findPattern(uintptr_t start, uintptr_t size, const std::string& pattern);
     bool read(uintptr_t address, void* buf, uintptr_t size);
-    bool read_blocking(uintptr_t address, void* buf, uintptr_t size);
+    MemoryCache::lookup readCached(uintptr_t address, void* buf, uintptr_t size);
+    bool read_blocking(uintptr_t address, void* buf, uintptr_t size, requestPriority priority = priority_normal);
+    bool readBatch(std::vector<readRange>& ranges, requestPriority priority = priority_normal, std::chrono::milliseconds deadline = {});
     bool write(uintptr_t address, const void* buf, uintptr_t size);
+
+    // Async requests, any number of them can be in flight. The promise is owned by the request
+    // so a reply that shows up after the caller stopped waiting is dropped safely. A read still
+    // queued after its deadline is dropped without an answer, its future reports failure.
+    void requestRead(uintptr_t address, uintptr_t size, std::function<void(bool, const uint8_t*, size_t)> callback,
+        requestPriority priority = priority_normal, std::chrono::milliseconds deadline = {});
+    std::future<std::vector<uint8_t>> readAsync(uintptr_t address, uintptr_t size, requestPriority priority = priority_normal);
+    std::future<std::vector<readRange>> readBatchAsync(std::vector<readRange> ranges,
+        requestPriority priority = priority_normal, std::chrono::milliseconds deadline = {});
+    std::future<bool> writeAsync(uintptr_t address, const void* buf, uintptr_t size);
+    std::future<uintptr_t> findPatternAsync(uintptr_t start, uintptr_t size, const std::string& pattern);
+    void scanPatternChunk(std::shared_ptr<patternScan> scan);
+
+    // Walks a pointer chain the way protocol::chainRequest describes, honoring the target's pointer width:
+    // every offset is added and a pointer read there, the last level reads size bytes instead.
+    // One round trip when the bridge has deref_chain, one read per level otherwise.
+    std::future<pointerChain> readPointerChainAsync(uintptr_t base, std::vector<int64_t> offsets, uintptr_t size,
+        requestPriority priority = priority_interactive);
+    bool readPointerChain(uintptr_t base, const std::vector<int64_t>& offsets, void* buf, uintptr_t size, pointerChain* chain = nullptr);
+    void walkPointerChain(std::shared_ptr<chainWalk> walk);
+    uintptr_t pointerSize();
+
+    // Reads count pointers stride bytes apart from base, then size bytes at every non-null pointer + offset
+    // (an entity list and the part of each entity that's needed). One gather request per frame's worth of
+    // elements when the bridge has the op, otherwise the array and then all targets as one batch.
+    std::future<std::vector<gatherEntry>> gatherAsync(uintptr_t base, uint32_t count, uint32_t stride, int32_t offset, uintptr_t size,
+        requestPriority priority = priority_normal, std::chrono::milliseconds deadline = {});
+    bool gather(uintptr_t base, uint32_t count, uint32_t stride, int32_t offset, uintptr_t size, std::vector<gatherEntry>& out,
+        requestPriority priority = priority_normal);
+
+    // Looks through freshly read bytes for values that could be pointers and reads a small window at each
+    // target the cache doesn't have yet, at background priority, so pointer previews, string previews and
+    // RTTI names are there by the time someone hovers them. Returns how many reads it issued, at most budget.
+    size_t prefetchTargets(const uint8_t* data, size_t size, size_t budget);
+
+    // the window read around a target: the vtable's object locator just before it, the preview after it
+    inline constexpr uintptr_t PREFETCH_BEFORE = 8;
+    inline constexpr uintptr_t PREFETCH_AFTER = 128;
+    // targets cached more recently than this aren't read again
+    inline constexpr std::chrono::milliseconds PREFETCH_MAX_AGE{ 1000 };
+    inline constexpr std::chrono::milliseconds PREFETCH_DEADLINE{ 250 };
+    inline std::atomic<uint64_t> g_Prefetched{ 0 };
+
+    void syncSubscriptions(const std::vector<readRange>& wanted, std::chrono::milliseconds interval);
+    bool isPushed(uintptr_t address, uintptr_t size);
+    void applyPush(uintptr_t address, uintptr_t size, uint64_t session, uint32_t sequence, bool delta, const uint8_t* bytes, size_t length);
+
+    // Every read goes through the coalescer, which hands merged spans to sendReads
+    void sendReads(std::vector<ReadCoalescer::Read> reads);
+    void sendRead(ReadCoalescer::Read read);
+    void cacheRead(uintptr_t address, uintptr_t size, bool success, const uint8_t* bytes, size_t length);
+
+    // how long a single read waits for neighbours before it goes out
+    inline constexpr std::chrono::microseconds READ_MERGE_WINDOW{ 500 };
+
+    inline ReadCoalescer g_ReadCoalescer(
+        [](std::vector<ReadCoalescer::Read> reads) { sendReads(std::move(reads)); },
+        [](std::function<void()> flush) { g_Bridge.defer(READ_MERGE_WINDOW, std::move(flush)); });
+
+    // Waits for an async result, false on timeout or if the request was dropped (stale or disconnected)
+    template <typename T>
+    bool waitResult(std::future<T>& future, std::chrono::milliseconds timeout, T& out);
     bool initProcess(DWORD pid);
     bool initProcessByName(const std::string& process_name);
+    void resumeSession();
     bool isX32(HANDLE handle);
     void clearCache();
 
+    // The UI pins the last published cache generation for a frame, everything it reads in between
+    // comes from that one generation without ever waiting on the memory thread
+    void pinFrame();
+    void unpinFrame();
+
 
 
     inline bool activeProcess = false;
@@ -104,6 +250,21 @@ namespace mem {
     void cleanDeadProcess();
 }
 
+template <typename T>
+bool mem::waitResult(std::future<T>& future, std::chrono::milliseconds timeout, T& out) {
+    if (!future.valid() || future.wait_for(timeout) != std::future_status::ready) {
+        return false;
+    }
+
+    try {
+        out = future.get();
+        return true;
+    }
+    catch (const std::future_error&) {
+        return false;
+    }
+}
+
 inline bool mem::isX32(HANDLE handle) {
     BOOL wow64 = FALSE;
     if (!IsWow64Process(handle, &wow64)) {
@@ -128,17 +289,27 @@ inline bool mem::rttiInfo(uintptr_t address, std::string& out) {
         return it->second.first;
     }
 
-    // Not in cache - do the lookup with blocking reads
+    // Not in cache - do the lookup, each level of the hierarchy is one round trip
     std::string result;
 
+    // The first level is usually prefetched along with the pointer. A negative entry fails right away
+    // but isn't remembered, it expires and the lookup is tried again then.
     uintptr_t objectLocatorPtr = 0;
-    if (!read_blocking(address - sizeof(void*), &objectLocatorPtr, sizeof(uintptr_t)) || !objectLocatorPtr) {
-        rttiCache[address] = { false, "" };
+    RTTICompleteObjectLocator objectLocator;
+    auto cached = readCached(address - sizeof(void*), &objectLocatorPtr, sizeof(uintptr_t));
+    if (cached == MemoryCache::cache_unreadable) {
         return false;
     }
-
-    RTTICompleteObjectLocator objectLocator;
-    if (!read_blocking(objectLocatorPtr, &objectLocator, sizeof(RTTICompleteObjectLocator))) {
+    if (cached == MemoryCache::cache_miss) {
+        // the vtable slot and the locator it points to as one pointer walk, a single round trip with deref_chain
+        pointerChain chain;
+        if (!readPointerChain(address, { -static_cast<int64_t>(sizeof(void*)), 0 }, &objectLocator, sizeof(objectLocator), &chain)) {
+            rttiCache[address] = { false, "" };
+            return false;
+        }
+        objectLocatorPtr = chain.addresses[1];
+    }
+    else if (!objectLocatorPtr || !read_blocking(objectLocatorPtr, &objectLocator, sizeof(RTTICompleteObjectLocator))) {
         rttiCache[address] = { false, "" };
         return false;
     }
@@ -159,25 +330,40 @@ inline bool mem::rttiInfo(uintptr_t address, std::string& out) {
         return false;
     }
 
-    for (DWORD i = 0; i < hierarchy.numBaseClasses; i++) {
-        DWORD classDescriptorRVA = 0;
-        if (!read_blocking(classArray + i * sizeof(DWORD), &classDescriptorRVA, sizeof(DWORD))) {
+    // one read for the whole base class array, then every lookup of the next level goes out at once
+    std::vector<DWORD> classDescriptorRVAs(hierarchy.numBaseClasses);
+    if (!read_blocking(classArray, classDescriptorRVAs.data(), classDescriptorRVAs.size() * sizeof(DWORD))) {
+        rttiCache[address] = { false, "" };
+        return false;
+    }
+
+    std::vector<std::future<std::vector<uint8_t>>> typeOffsetReads;
+    for (DWORD classDescriptorRVA : classDescriptorRVAs) {
+        typeOffsetReads.push_back(readAsync(baseModule + classDescriptorRVA, sizeof(DWORD)));
+    }
+
+    std::vector<std::future<std::vector<uint8_t>>> typeDescriptorReads(typeOffsetReads.size());
+    for (size_t i = 0; i < typeOffsetReads.size(); i++) {
+        std::vector<uint8_t> bytes;
+        if (!waitResult(typeOffsetReads[i], std::chrono::milliseconds(50), bytes) || bytes.size() < sizeof(DWORD)) {
             continue;
         }
 
-        uintptr_t classDescriptor = baseModule + classDescriptorRVA;
-
         DWORD typeDescriptorOffset = 0;
-        if (!read_blocking(classDescriptor, &typeDescriptorOffset, sizeof(DWORD))) {
+        memcpy(&typeDescriptorOffset, bytes.data(), sizeof(DWORD));
+        typeDescriptorReads[i] = readAsync(baseModule + typeDescriptorOffset, sizeof(TypeDescriptor));
+    }
+
+    for (auto& typeDescriptorRead : typeDescriptorReads) {
+        std::vector<uint8_t> bytes;
+        if (!waitResult(typeDescriptorRead, std::chrono::milliseconds(50), bytes) || bytes.size() < sizeof(TypeDescriptor)) {
             continue;
         }
 
         TypeDescriptor typeDescriptor;
-        if (!read_blocking(baseModule + typeDescriptorOffset, &typeDescriptor, sizeof(TypeDescriptor))) {
-            continue;
-        }
+        memcpy(&typeDescriptor, bytes.data(), sizeof(TypeDescriptor));
 
-        std::string name = typeDescriptor.name;
+        std::string name(typeDescriptor.name, strnlen(typeDescriptor.name, sizeof(typeDescriptor.name)));
         if (!name.ends_with("@@")) {
             continue;  // CHANGED: don't return false, just skip this entry
         }
@@ -255,7 +441,7 @@ inline bool mem::getProcessList() {
 }
 
 inline void mem::getModules() {
-    if (!g_WebSocketServer.is_connected() || !activeProcess) {
+    if (!g_Bridge.is_connected() || !activeProcess) {
         logger::addLog("[Memory] Cannot get modules - not connected or no process");
         return;
     }
@@ -264,8 +450,8 @@ inline void mem::getModules() {
 
     json data;
 
-    g_WebSocketServer.send_request("get_modules", data,
-        [](const std::string& response) {
+    g_Bridge.send_request("get_modules", data,
+        [](std::string_view response) {
             try {
                 auto j = json::parse(response);
 
@@ -308,6 +494,9 @@ inline void mem::getModules() {
                     }
 
                     logger::addLog("[Memory] Loaded " + std::to_string(moduleList.size()) + " modules");
+
+                    // export names are harvested on the memory thread, never block the network thread on it
+                    g_NeedsExportRefresh = true;
                 }
                 else {
                     std::string error = j.value("error", "Unknown error");
@@ -352,13 +541,13 @@ inline std::vector<funcExport> mem::gatherRemoteExports(uintptr_t moduleBase)
     std::vector<funcExport> exports;
     IMAGE_DOS_HEADER dosHeader;
 
-    if (!read(moduleBase, &dosHeader, sizeof(IMAGE_DOS_HEADER)) || dosHeader.e_magic != IMAGE_DOS_SIGNATURE) {
+    if (!read_blocking(moduleBase, &dosHeader, sizeof(IMAGE_DOS_HEADER), priority_background) || dosHeader.e_magic != IMAGE_DOS_SIGNATURE) {
         return exports;
     }
 
     IMAGE_NT_HEADERS ntHeaders;
 
-    if (!read(moduleBase + dosHeader.e_lfanew, &ntHeaders, sizeof(IMAGE_NT_HEADERS)) ||
+    if (!read_blocking(moduleBase + dosHeader.e_lfanew, &ntHeaders, sizeof(IMAGE_NT_HEADERS), priority_background) ||
         ntHeaders.Signature != IMAGE_NT_SIGNATURE) {
         return exports;
     }
@@ -372,54 +561,80 @@ inline std::vector<funcExport> mem::gatherRemoteExports(uintptr_t moduleBase)
 
     IMAGE_EXPORT_DIRECTORY exportDir;
 
-    if (!read(moduleBase + exportDirRVA, &exportDir, sizeof(IMAGE_EXPORT_DIRECTORY))) {
+    if (!read_blocking(moduleBase + exportDirRVA, &exportDir, sizeof(IMAGE_EXPORT_DIRECTORY), priority_background)) {
         return exports;
     }
 
-    std::vector<DWORD> functionRVAs(exportDir.NumberOfFunctions);
-
-    if (!read(moduleBase + exportDir.AddressOfFunctions, functionRVAs.data(),
-        exportDir.NumberOfFunctions * sizeof(DWORD))) {
+    if (!exportDir.NumberOfFunctions || !exportDir.NumberOfNames) {
         return exports;
     }
 
-    std::vector<DWORD> nameRVAs(exportDir.NumberOfNames);
+    constexpr auto EXPORT_READ_TIMEOUT = std::chrono::milliseconds(500);
 
-    if (!read(moduleBase + exportDir.AddressOfNames, nameRVAs.data(),
-        exportDir.NumberOfNames * sizeof(DWORD))) {
+    // the three tables go out in one batch
+    std::vector<readRange> tables = {
+        { moduleBase + exportDir.AddressOfFunctions, exportDir.NumberOfFunctions * sizeof(DWORD) },
+        { moduleBase + exportDir.AddressOfNames, exportDir.NumberOfNames * sizeof(DWORD) },
+        { moduleBase + exportDir.AddressOfNameOrdinals, exportDir.NumberOfNames * sizeof(WORD) },
+    };
+
+    auto tablesFuture = readBatchAsync(std::move(tables), priority_background, EXPORT_READ_TIMEOUT);
+    if (!waitResult(tablesFuture, EXPORT_READ_TIMEOUT, tables) || tables.size() != 3 ||
+        !tables[0].success || !tables[1].success || !tables[2].success) {
         return exports;
     }
 
-    std::vector<WORD> ordinals(exportDir.NumberOfNames);
+    const DWORD* functionRVAs = reinterpret_cast<const DWORD*>(tables[0].data.data());
+    const DWORD* nameRVAs = reinterpret_cast<const DWORD*>(tables[1].data.data());
+    const WORD* ordinals = reinterpret_cast<const WORD*>(tables[2].data.data());
+
+    // names are packed next to each other, so read them as a handful of contiguous spans
+    // instead of one request per name
+    constexpr DWORD MAX_NAME_LENGTH = 255;
+    constexpr DWORD MAX_SPAN_SIZE = 64 * 1024;
+
+    std::vector<DWORD> sortedNameRVAs(nameRVAs, nameRVAs + exportDir.NumberOfNames);
+    std::sort(sortedNameRVAs.begin(), sortedNameRVAs.end());
+
+    std::vector<readRange> spans;
+    for (DWORD nameRVA : sortedNameRVAs) {
+        if (!spans.empty()) {
+            auto& span = spans.back();
+            uintptr_t spanEnd = span.address + span.size;
+            if (moduleBase + nameRVA <= spanEnd && span.size < MAX_SPAN_SIZE) {
+                span.size = moduleBase + nameRVA + MAX_NAME_LENGTH - span.address;
+                continue;
+            }
+        }
+        spans.push_back({ moduleBase + nameRVA, MAX_NAME_LENGTH });
+    }
 
-    if (!read(moduleBase + exportDir.AddressOfNameOrdinals, ordinals.data(),
-        exportDir.NumberOfNames * sizeof(WORD))) {
+    auto spansFuture = readBatchAsync(std::move(spans), priority_background, EXPORT_READ_TIMEOUT);
+    if (!waitResult(spansFuture, EXPORT_READ_TIMEOUT, spans)) {
         return exports;
     }
 
-
     exports.reserve(exportDir.NumberOfNames);
 
-    // TODO: refactor this to use less individual read calls (most names end up in the same pages anyway...)
     for (DWORD i = 0; i < exportDir.NumberOfNames; ++i) {
-        char nameBuffer[256] = { 0 };
-        DWORD nameRVA = nameRVAs[i];
-
-        DWORD readSize = 255;
+        uintptr_t nameAddress = moduleBase + nameRVAs[i];
 
-        if (i + 1 < exportDir.NumberOfNames) {
-            DWORD nextNameRVA = nameRVAs[i + 1];
-            DWORD NameDelta = nextNameRVA - nameRVA;
-            if (NameDelta > 0 && NameDelta < 255)
-                readSize = NameDelta; // don't need to read more than this delta
+        // last span starting at or before the name
+        auto spanIt = std::upper_bound(spans.begin(), spans.end(), nameAddress,
+            [](uintptr_t address, const readRange& span) { return address < span.address; });
+        if (spanIt == spans.begin()) {
+            continue;
         }
+        --spanIt;
 
-
-        if (!read(moduleBase + nameRVA, nameBuffer, readSize)) {
+        if (!spanIt->success || nameAddress >= spanIt->address + spanIt->size) {
             continue;
         }
 
-        std::string exportName = nameBuffer;
+        const char* name = reinterpret_cast<const char*>(spanIt->data.data()) + (nameAddress - spanIt->address);
+        size_t available = spanIt->address + spanIt->size - nameAddress;
+
+        std::string exportName(name, strnlen(name, (std::min)(available, static_cast<size_t>(MAX_NAME_LENGTH))));
         if (exportName.empty()) {
             continue;
         }
@@ -444,26 +659,54 @@ inline std::vector<funcExport> mem::gatherRemoteExports(uintptr_t moduleBase)
     return exports;
 }
 
-inline void mem::gatherExports()
+// Runs on the memory thread. Walks at least one module per call and keeps going until the budget
+// is spent, the map is built on the side and swapped in once every module is done so lookups never
+// see a half-built map. A refresh requested mid-walk starts over.
+inline void mem::gatherExports(std::chrono::milliseconds budget)
 {
-    g_ExportMap.clear();
+    if (g_NeedsExportRefresh.exchange(false)) {
+        g_ExportWalk = {};
+        g_ExportWalk.modules = moduleList;
+        g_ExportWalk.active = true;
+    }
 
-    for (auto& module : moduleList) {
-        char modulePath[MAX_PATH] = { 0 };
-        if (K32GetModuleFileNameExA(memHandle, reinterpret_cast<HMODULE>(module.base), modulePath, MAX_PATH)) {
-            auto exports = gatherRemoteExports(module.base);
+    if (!g_ExportWalk.active) {
+        return;
+    }
 
-            for (const auto& exp : exports) {
-                g_ExportMap[exp.address] = module.name + "!" + exp.name;
-            }
+    auto stopAt = std::chrono::steady_clock::now() + budget;
+    do {
+        if (g_ExportWalk.next >= g_ExportWalk.modules.size()) {
+            break;
+        }
+
+        auto& module = g_ExportWalk.modules[g_ExportWalk.next++];
+        auto exports = gatherRemoteExports(module.base);
+
+        for (const auto& exp : exports) {
+            g_ExportWalk.exportMap[exp.address] = module.name + "!" + exp.name;
         }
+    } while (std::chrono::steady_clock::now() < stopAt);
+
+    if (g_ExportWalk.next < g_ExportWalk.modules.size()) {
+        return;
     }
+
+    size_t exportCount = g_ExportWalk.exportMap.size();
+    {
+        std::lock_guard<std::mutex> lock(g_ExportMutex);
+        g_ExportMap = std::move(g_ExportWalk.exportMap);
+    }
+    g_ExportWalk = {};
+
+    logger::addLog("[Memory] Loaded " + std::to_string(exportCount) + " exports");
 }
 
 inline uintptr_t mem::getExport(const std::string& moduleName, const std::string& exportName)
 {
     for (auto& module : moduleList) {
         if (_stricmp(module.name.c_str(), moduleName.c_str()) == 0) {
+            std::lock_guard<std::mutex> lock(g_ExportMutex);
             for (auto& pair : g_ExportMap) {
                 std::string fullExport = module.name + "!" + exportName;
                 if (pair.second == fullExport) {
@@ -506,21 +749,33 @@ inline void mem::cleanDeadProcess() {
     }
 
     moduleList.clear();
-    g_ExportMap.clear();
+    {
+        std::lock_guard<std::mutex> lock(g_ExportMutex);
+        g_ExportMap.clear();
+    }
     g_pid = 0;
+    g_base = 0;
     activeProcess = false;
 
-    // Clear memory snapshots
-    {
-        std::lock_guard<std::mutex> lock(g_MemoryMutex);
-        g_MemorySnapshots.clear();
-    }
+    clearCache();
+}
+
+inline void mem::clearCache() {
+    g_MemoryCache.clear();
+}
+
+inline void mem::pinFrame() {
+    t_FrameGeneration = g_MemoryCache.pinned();
+}
+
+inline void mem::unpinFrame() {
+    t_FrameGeneration.reset();
 }
 
 extern void initClasses(bool);
 
 inline bool mem::initProcessByName(const std::string& process_name) {
-    if (!g_WebSocketServer.is_connected()) {
+    if (!g_Bridge.is_connected()) {
         logger::addLog("[Memory] WebSocket not connected to Perception!");
         return false;
     }
@@ -530,8 +785,8 @@ inline bool mem::initProcessByName(const std::string& process_name) {
     json data;
     data["process_name"] = process_name;
 
-    g_WebSocketServer.send_request("ref_process", data,
-        [process_name](const std::string& response) {
+    g_Bridge.send_request("ref_process", data,
+        [process_name](std::string_view response) {
             try {
                 auto j = json::parse(response);
 
@@ -547,6 +802,7 @@ inline bool mem::initProcessByName(const std::string& process_name) {
                     bool is_x32 = (is_x32_str == "true");
 
                     mem::g_pid = static_cast<DWORD>(pid);
+                    mem::g_base = static_cast<uintptr_t>(base);
                     mem::activeProcess = true;
 
                     char base_hex[32], peb_hex[32];
@@ -582,7 +838,7 @@ inline bool mem::initProcessByName(const std::string& process_name) {
 }
 
 inline bool mem::initProcess(DWORD pid) {
-    if (!g_WebSocketServer.is_connected()) {
+    if (!g_Bridge.is_connected()) {
         logger::addLog("[Memory] WebSocket not connected to Perception!");
         return false;
     }
@@ -592,8 +848,8 @@ inline bool mem::initProcess(DWORD pid) {
     json data;
     data["pid"] = pid;
 
-    g_WebSocketServer.send_request("ref_process", data,
-        [pid](const std::string& response) {
+    g_Bridge.send_request("ref_process", data,
+        [pid](std::string_view response) {
             try {
                 auto j = json::parse(response);
 
@@ -601,9 +857,11 @@ inline bool mem::initProcess(DWORD pid) {
                     mem::g_pid = pid;
                     mem::activeProcess = true;
 
-                    uint64_t base = j["base_address"].get<uint64_t>();
-                    uint64_t peb = j["peb"].get<uint64_t>();
-                    bool is_x32 = j["is_x32"].get<bool>();
+                    // the bridge sends every field as a string, same as the by-name path
+                    uint64_t base = std::stoull(j["base_address"].get<std::string>(), nullptr, 16);
+                    uint64_t peb = std::stoull(j["peb"].get<std::string>(), nullptr, 16);
+                    bool is_x32 = (j["is_x32"].get<std::string>() == "true");
+                    mem::g_base = static_cast<uintptr_t>(base);
 
                     char base_str[32], peb_str[32];
                     sprintf_s(base_str, "0x%llX", base);
@@ -633,30 +891,74 @@ inline bool mem::initProcess(DWORD pid) {
     return true;
 }
 
-inline bool mem::read(uintptr_t address, void* buf, uintptr_t size) {
-    if (!g_WebSocketServer.is_connected() || !activeProcess) {
-        return false;
+// Runs on the memory thread after every bridge hello. A bridge that resumed our session, or that still
+// has our process attached, just carries on. Otherwise the process is attached again by PID, and if the
+// image base matches too it's the same process: modules, exports and RTTI stay cached and the classes
+// pick up where they were. Anything else starts over like a fresh attach.
+inline void mem::resumeSession() {
+    if (!g_pid) {
+        return;
     }
 
-    // Try to use existing data from background thread cache
-    {
-        std::lock_guard<std::mutex> lock(g_MemoryMutex);
+    auto attachment = g_Bridge.attachment();
+    if (attachment.pid == g_pid && attachment.base == g_base) {
+        logger::addLog(std::string("[Memory] ") + (attachment.resumed ? "Session resumed" : "Bridge still attached") +
+            ", keeping PID " + std::to_string(g_pid));
+        activeProcess = true;
+        return;
+    }
 
-        // Check if this address is covered by any cached snapshot
-        for (auto& [cached_addr, cached_data] : g_MemorySnapshots) {
-            // Make sure cached_data is valid before accessing
-            if (cached_data.empty()) continue;
+    DWORD pid = g_pid;
+    uintptr_t base = g_base;
+    logger::addLog("[Memory] Re-attaching to PID " + std::to_string(pid));
 
-            if (address >= cached_addr && address + size <= cached_addr + cached_data.size()) {
-                size_t offset = address - cached_addr;
+    json data;
+    data["pid"] = pid;
+
+    g_Bridge.send_request("ref_process", data,
+        [pid, base](std::string_view response) {
+            try {
+                auto j = json::parse(response);
+
+                if (!j.contains("success") || !j["success"].get<bool>()) {
+                    logger::addLog("[Memory] Re-attach failed: " + j.value("error", std::string("Unknown error")));
+                    mem::activeProcess = false;
+                    return;
+                }
 
-                // Safety check
-                if (offset + size <= cached_data.size()) {
-                    memcpy(buf, cached_data.data() + offset, size);
-                    return true;
+                uint64_t attachedBase = std::stoull(j["base_address"].get<std::string>(), nullptr, 16);
+                if (attachedBase == base) {
+                    logger::addLog("[Memory] Re-attached to the same process, caches kept");
+                    mem::activeProcess = true;
+                    return;
                 }
+
+                // the PID got reused, nothing cached belongs to this process
+                logger::addLog("[Memory] PID " + std::to_string(pid) + " is a different process now, starting over");
+                clearCache();
+
+                bool is_x32 = (j["is_x32"].get<std::string>() == "true");
+                mem::g_base = static_cast<uintptr_t>(attachedBase);
+                mem::x32 = is_x32;
+                initClasses(is_x32);
+                mem::activeProcess = true;
+                mem::g_NeedsModuleRefresh = true;
             }
-        }
+            catch (const std::exception& e) {
+                logger::addLog("[Memory] Error parsing ref_process response: " + std::string(e.what()));
+                mem::activeProcess = false;
+            }
+        }, priority_interactive);
+}
+
+inline bool mem::read(uintptr_t address, void* buf, uintptr_t size) {
+    if (!g_Bridge.is_connected() || !activeProcess) {
+        return false;
+    }
+
+    // Served from whatever pages earlier reads left in the cache
+    if (readCached(address, buf, size) == MemoryCache::cache_hit) {
+        return true;
     }
 
     // Not in cache - return zeros for now (will be filled next frame)
@@ -664,65 +966,409 @@ inline bool mem::read(uintptr_t address, void* buf, uintptr_t size) {
     return false;
 }
 
-inline bool mem::read_blocking(uintptr_t address, void* buf, uintptr_t size) {
-    if (!g_WebSocketServer.is_connected() || !activeProcess) {
-        return false;
+inline MemoryCache::lookup mem::readCached(uintptr_t address, void* buf, uintptr_t size) {
+    if (t_FrameGeneration) {
+        return t_FrameGeneration->read(address, buf, size);
     }
+    return g_MemoryCache.read(address, buf, size);
+}
 
-    auto promise_ptr = std::make_shared<std::promise<std::vector<uint8_t>>>();
-    std::future<std::vector<uint8_t>> future = promise_ptr->get_future();
+inline void mem::requestRead(uintptr_t address, uintptr_t size, std::function<void(bool, const uint8_t*, size_t)> callback,
+    requestPriority priority, std::chrono::milliseconds deadline) {
+    if (!g_Bridge.is_connected() || !activeProcess) {
+        callback(false, nullptr, 0);
+        return;
+    }
+
+    g_ReadCoalescer.read(address, size, priority, deadline, std::move(callback));
+}
+
+// Whatever the bridge answers goes into the page cache. Only bytes that actually came back are stored,
+// what it answered short is a failed read (see MemoryCache::markUnreadable). A failed request (no process,
+// or dropped before it was answered) says nothing about the memory and leaves the cache alone.
+inline void mem::cacheRead(uintptr_t address, uintptr_t size, bool success, const uint8_t* bytes, size_t length) {
+    if (!success) {
+        return;
+    }
+
+    uintptr_t received = (std::min)(uintptr_t(length), size);
+    if (received) {
+        g_MemoryCache.store(address, bytes, received);
+    }
+    if (received < size) {
+        g_MemoryCache.markUnreadable(address + received, size - received);
+    }
+}
+
+// One span as a single rvm
+inline void mem::sendRead(ReadCoalescer::Read read) {
+    auto completion = std::move(read.completion);
+
+    // frames can't carry more than the session allows, bigger reads take the JSON path
+    if (g_Bridge.supports(protocol::op_rvm) && read.size <= g_Bridge.max_payload()) {
+        g_Bridge.send_binary_request(protocol::op_rvm, read.address, static_cast<uint32_t>(read.size), nullptr, 0,
+            [completion, address = read.address, size = read.size](bool success, const uint8_t* bytes, size_t length) {
+                cacheRead(address, size, success, bytes, length);
+                completion->complete(success, bytes, length);
+            }, read.priority, read.deadline);
+        return;
+    }
 
     json data;
-    data["address"] = std::to_string(address);
-    data["size"] = std::to_string(size);
+    data["address"] = std::to_string(read.address);
+    data["size"] = std::to_string(read.size);
 
-    g_WebSocketServer.send_request("rvm", data,
-        [promise_ptr, size](const std::string& response) {
+    g_Bridge.send_request("rvm", data,
+        [completion, address = read.address, size = read.size](std::string_view response) {
             try {
                 auto j = json::parse(response);
 
                 if (j.contains("success") && j["success"].get<bool>()) {
                     std::string hex_data = j["data"].get<std::string>();
-                    std::vector<uint8_t> buffer(size);
 
-                    for (size_t i = 0; i < size && i * 2 < hex_data.size(); i++) {
+                    // a short reply is as many bytes as came back, never padded: waiters past the end fail
+                    std::vector<uint8_t> buffer((std::min)(size_t(size), hex_data.size() / 2));
+                    for (size_t i = 0; i < buffer.size(); i++) {
                         std::string byte_str = hex_data.substr(i * 2, 2);
                         buffer[i] = (uint8_t)strtoul(byte_str.c_str(), nullptr, 16);
                     }
 
-                    promise_ptr->set_value(std::move(buffer));
+                    cacheRead(address, size, true, buffer.data(), buffer.size());
+                    completion->complete(true, buffer.data(), buffer.size());
                 }
                 else {
-                    promise_ptr->set_value(std::vector<uint8_t>());
+                    cacheRead(address, size, false, nullptr, 0);
+                    completion->complete(false, nullptr, 0);
                 }
             }
             catch (const std::exception& e) {
                 logger::addLog("[Memory] rvm error: " + std::string(e.what()));
+                completion->complete(false, nullptr, 0);
+            }
+        }, read.priority, read.deadline);
+}
+
+// Spans of the same priority share rvm_batch requests, anything that can't be batched goes out alone.
+// Returning without sending drops the completions, which fails their waiters.
+inline void mem::sendReads(std::vector<ReadCoalescer::Read> reads) {
+    if (!g_Bridge.is_connected() || !activeProcess) {
+        return;
+    }
+
+    // keep single responses at a sane size, and inside the session's frame limit
+    // (every range costs its length prefix in the reply)
+    const size_t batchMaxBytes = (std::min)(size_t(1024 * 1024), size_t(g_Bridge.max_payload()));
+    const bool batching = g_Bridge.supports(protocol::op_rvm_batch);
+
+    std::vector<ReadCoalescer::Read> batchable;
+    for (auto& read : reads) {
+        if (batching && sizeof(uint32_t) + read.size <= batchMaxBytes) {
+            batchable.push_back(std::move(read));
+        }
+        else {
+            sendRead(std::move(read));
+        }
+    }
+
+    std::stable_sort(batchable.begin(), batchable.end(),
+        [](const ReadCoalescer::Read& a, const ReadCoalescer::Read& b) { return a.priority < b.priority; });
+
+    for (size_t first = 0; first < batchable.size();) {
+        size_t last = first;
+        size_t batchBytes = 0;
+        while (last < batchable.size() && batchable[last].priority == batchable[first].priority &&
+            batchBytes + sizeof(uint32_t) + batchable[last].size <= batchMaxBytes) {
+            batchBytes += sizeof(uint32_t) + batchable[last].size;
+            last++;
+        }
+
+        if (last - first == 1) {
+            sendRead(std::move(batchable[first]));
+            first = last;
+            continue;
+        }
+
+        // a batch waits as long as its most patient span
+        uint32_t count = static_cast<uint32_t>(last - first);
+        std::vector<uint8_t> payload(sizeof(count) + count * sizeof(protocol::batchRange));
+        memcpy(payload.data(), &count, sizeof(count));
+
+        std::vector<std::shared_ptr<ReadCoalescer::Completion>> completions;
+        std::vector<protocol::batchRange> entries;
+        std::chrono::milliseconds deadline = batchable[first].deadline;
+        for (size_t i = first; i < last; i++) {
+            auto& read = batchable[i];
+            protocol::batchRange entry{ read.address, static_cast<uint32_t>(read.size) };
+            memcpy(payload.data() + sizeof(count) + (i - first) * sizeof(entry), &entry, sizeof(entry));
+            entries.push_back(entry);
+            completions.push_back(std::move(read.completion));
+            deadline = (!deadline.count() || !read.deadline.count()) ? std::chrono::milliseconds{} : (std::max)(deadline, read.deadline);
+        }
+
+        g_Bridge.send_binary_request(protocol::op_rvm_batch, 0, static_cast<uint32_t>(payload.size()), payload.data(), payload.size(),
+            [completions, entries](bool success, const uint8_t* bytes, size_t length) {
+                size_t offset = 0;
+                for (size_t i = 0; i < completions.size(); i++) {
+                    auto& completion = completions[i];
+                    uint32_t readSize = 0;
+                    if (!success || offset + sizeof(readSize) > length) {
+                        completion->complete(false, nullptr, 0);
+                        continue;
+                    }
+
+                    memcpy(&readSize, bytes + offset, sizeof(readSize));
+                    offset += sizeof(readSize);
+
+                    if (offset + readSize > length) {
+                        success = false;
+                        completion->complete(false, nullptr, 0);
+                        continue;
+                    }
+
+                    // a short range caches what came back, the rest counts as unreadable
+                    cacheRead(entries[i].address, entries[i].size, true, bytes + offset, readSize);
+                    completion->complete(true, bytes + offset, readSize);
+                    offset += readSize;
+                }
+            }, batchable[first].priority, deadline);
+
+        first = last;
+    }
+}
+
+inline std::future<std::vector<uint8_t>> mem::readAsync(uintptr_t address, uintptr_t size, requestPriority priority) {
+    auto promise_ptr = std::make_shared<std::promise<std::vector<uint8_t>>>();
+    std::future<std::vector<uint8_t>> future = promise_ptr->get_future();
+
+    requestRead(address, size,
+        [promise_ptr, size](bool success, const uint8_t* bytes, size_t length) {
+            if (success && length >= size) {
+                promise_ptr->set_value(std::vector<uint8_t>(bytes, bytes + size));
+            }
+            else {
                 promise_ptr->set_value(std::vector<uint8_t>());
             }
+        }, priority);
+
+    return future;
+}
+
+inline bool mem::read_blocking(uintptr_t address, void* buf, uintptr_t size, requestPriority priority) {
+    auto future = readAsync(address, size, priority);
+
+    std::vector<uint8_t> result;
+    if (waitResult(future, std::chrono::milliseconds(50), result) && result.size() >= size) {
+        memcpy(buf, result.data(), size);
+        return true;
+    }
+
+    return false;
+}
+
+// Runs on the memory thread. Subscribes ranges that just showed up and unsubscribes the ones nobody
+// wants anymore (class closed or moved), everything starts over when the session or process changes.
+// Ranges the bridge refused stay in the table unpushed, so they're polled instead of retried.
+inline void mem::syncSubscriptions(const std::vector<readRange>& wanted, std::chrono::milliseconds interval) {
+    bool canPush = g_Bridge.can_subscribe() && activeProcess;
+    uint64_t session = g_Bridge.session_id();
+
+    auto isWanted = [&](const subscription& sub) {
+        return std::any_of(wanted.begin(), wanted.end(), [&](const readRange& range) {
+            return range.address == sub.address && range.size == sub.size;
+            });
+    };
+
+    // held across subscribe so a push can't be applied before its entry exists
+    std::lock_guard<std::mutex> lock(g_SubscriptionMutex);
+
+    std::erase_if(g_Subscriptions, [&](const subscription& sub) {
+        bool current = sub.session == session;
+        if (canPush && current && sub.pid == g_pid && isWanted(sub)) {
+            return false;
+        }
+        if (current) {
+            g_Bridge.unsubscribe(sub.id);
+        }
+        return true;
         });
 
-    if (future.wait_for(std::chrono::milliseconds(50)) == std::future_status::ready) {
-        auto result = future.get();
-        if (!result.empty() && result.size() >= size) {
-            memcpy(buf, result.data(), size);
-            return true;
+    if (!canPush) {
+        return;
+    }
+
+    for (auto& range : wanted) {
+        bool known = std::any_of(g_Subscriptions.begin(), g_Subscriptions.end(), [&](const subscription& sub) {
+            return sub.address == range.address && sub.size == range.size;
+            });
+        if (known || !range.size) {
+            continue;
+        }
+
+        uintptr_t address = range.address;
+        uintptr_t size = range.size;
+        uint32_t id = g_Bridge.subscribe(address, static_cast<uint32_t>(size), interval,
+            [address, size, session](uint32_t sequence, bool delta, const uint8_t* bytes, size_t length) {
+                applyPush(address, size, session, sequence, delta, bytes, length);
+            },
+            [address, size, session](bool success) {
+                std::lock_guard<std::mutex> lock(g_SubscriptionMutex);
+                for (auto& sub : g_Subscriptions) {
+                    if (sub.address == address && sub.size == size && sub.session == session) {
+                        sub.pushing = success;
+                    }
+                }
+            });
+
+        // 0 means it never went out, the next pass tries again
+        if (id) {
+            g_Subscriptions.push_back({ address, size, id, session, g_pid });
         }
     }
+}
 
-    return false;
+inline bool mem::isPushed(uintptr_t address, uintptr_t size) {
+    std::lock_guard<std::mutex> lock(g_SubscriptionMutex);
+    return std::any_of(g_Subscriptions.begin(), g_Subscriptions.end(), [&](const subscription& sub) {
+        return sub.pushing && sub.address == address && sub.size == size;
+        });
 }
 
-inline bool mem::write(uintptr_t address, const void* buf, uintptr_t size) {
-    if (!g_WebSocketServer.is_connected() || !activeProcess) {
+// Pushes for one subscription arrive in order. Deltas apply to the subscription's own copy of the
+// last version rather than the snapshot, which a poll may have written in the meantime. A delta that
+// doesn't follow the previous push asks for the whole range and everything up to it is skipped.
+inline void mem::applyPush(uintptr_t address, uintptr_t size, uint64_t session, uint32_t sequence, bool delta, const uint8_t* bytes, size_t length) {
+    std::lock_guard<std::mutex> lock(g_SubscriptionMutex);
+    for (auto& sub : g_Subscriptions) {
+        if (sub.address != address || sub.size != size || sub.session != session) {
+            continue;
+        }
+
+        if (sequence <= sub.lastSequence) {
+            return;
+        }
+
+        if (delta) {
+            bool applies = !sub.resyncing && sequence == sub.lastSequence + 1 && sub.base.size() == size &&
+                protocol::applyDelta(sub.base.data(), sub.base.size(), bytes, length);
+            if (!applies) {
+                if (!sub.resyncing) {
+                    sub.resyncing = true;
+                    g_Bridge.resync(sub.id);
+                }
+                return;
+            }
+        }
+        else {
+            if (length < size) {
+                return;
+            }
+            sub.base.assign(bytes, bytes + size);
+            sub.resyncing = false;
+        }
+
+        sub.lastSequence = sequence;
+        sub.pushing = true;
+
+        g_MemoryCache.store(address, sub.base.data(), sub.base.size());
+        return;
+    }
+}
+
+// Hands every range to the coalescer and flushes, so the whole set goes out together (as rvm_batch
+// requests where the bridge has them). The future resolves when the last range has reported back.
+inline std::future<std::vector<readRange>> mem::readBatchAsync(std::vector<readRange> ranges,
+    requestPriority priority, std::chrono::milliseconds deadline) {
+    struct batchState {
+        std::mutex mutex;
+        std::vector<readRange> ranges;
+        size_t remaining = 0;
+        std::promise<std::vector<readRange>> promise;
+    };
+
+    auto state = std::make_shared<batchState>();
+    auto future = state->promise.get_future();
+
+    for (auto& range : ranges) {
+        range.success = false;
+    }
+    state->ranges = std::move(ranges);
+
+    if (state->ranges.empty() || !g_Bridge.is_connected() || !activeProcess) {
+        state->promise.set_value(std::move(state->ranges));
+        return future;
+    }
+
+    state->remaining = state->ranges.size();
+
+    for (size_t i = 0; i < state->ranges.size(); i++) {
+        g_ReadCoalescer.read(state->ranges[i].address, state->ranges[i].size, priority, deadline,
+            [state, i](bool success, const uint8_t* bytes, size_t length) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                auto& range = state->ranges[i];
+                range.success = success && length >= range.size;
+                if (range.success) {
+                    range.data.assign(bytes, bytes + range.size);
+                }
+
+                if (--state->remaining == 0) {
+                    state->promise.set_value(std::move(state->ranges));
+                }
+            });
+    }
+    g_ReadCoalescer.flush();
+
+    return future;
+}
+
+// Blocking wrapper around readBatchAsync. Returns false if any range failed.
+inline bool mem::readBatch(std::vector<readRange>& ranges, requestPriority priority, std::chrono::milliseconds deadline) {
+    auto future = readBatchAsync(ranges, priority, deadline);
+
+    std::vector<readRange> results;
+    if (!waitResult(future, std::chrono::milliseconds(100), results) || results.size() != ranges.size()) {
+        for (auto& range : ranges) {
+            range.success = false;
+        }
         return false;
     }
 
+    bool allRead = true;
+    for (size_t i = 0; i < ranges.size(); i++) {
+        ranges[i].success = results[i].success;
+        if (results[i].success) {
+            ranges[i].data = std::move(results[i].data);
+        }
+        allRead &= ranges[i].success;
+    }
+
+    return allRead;
+}
+
+inline std::future<bool> mem::writeAsync(uintptr_t address, const void* buf, uintptr_t size) {
     auto promise_ptr = std::make_shared<std::promise<bool>>();
     std::future<bool> future = promise_ptr->get_future();
 
-    std::string hex_data;
+    if (!g_Bridge.is_connected() || !activeProcess) {
+        promise_ptr->set_value(false);
+        return future;
+    }
+
+    // a write that went through is what the cache should show from now on
     const uint8_t* bytes = static_cast<const uint8_t*>(buf);
+    auto written = std::make_shared<std::vector<uint8_t>>(bytes, bytes + size);
+
+    if (g_Bridge.supports(protocol::op_wvm) && size <= g_Bridge.max_payload()) {
+        g_Bridge.send_binary_request(protocol::op_wvm, address, static_cast<uint32_t>(size), buf, size,
+            [promise_ptr, address, written](bool success, const uint8_t*, size_t) {
+                if (success) {
+                    g_MemoryCache.store(address, written->data(), written->size());
+                }
+                promise_ptr->set_value(success);
+            }, priority_interactive);
+        return future;
+    }
+
+    std::string hex_data;
     for (size_t i = 0; i < size; i++) {
         char hex[3];
         sprintf_s(hex, "%02X", bytes[i]);
@@ -733,12 +1379,13 @@ inline bool mem::write(uintptr_t address, const void* buf, uintptr_t size) {
     data["address"] = std::to_string(address);
     data["data"] = hex_data;
 
-    g_WebSocketServer.send_request("wvm", data,
-        [promise_ptr](const std::string& response) {
+    g_Bridge.send_request("wvm", data,
+        [promise_ptr, address, written](std::string_view response) {
             try {
                 auto j = json::parse(response);
 
                 if (j.contains("success") && j["success"].get<bool>()) {
+                    g_MemoryCache.store(address, written->data(), written->size());
                     promise_ptr->set_value(true);
                 }
                 else {
@@ -749,59 +1396,364 @@ inline bool mem::write(uintptr_t address, const void* buf, uintptr_t size) {
                 logger::addLog("[Memory] wvm error: " + std::string(e.what()));
                 promise_ptr->set_value(false);
             }
-        });
+        }, priority_interactive);
 
-    if (future.wait_for(std::chrono::milliseconds(100)) == std::future_status::ready) {
-        return future.get();
-    }
+    return future;
+}
 
-    return false;
+inline bool mem::write(uintptr_t address, const void* buf, uintptr_t size) {
+    auto future = writeAsync(address, buf, size);
+
+    bool success = false;
+    return waitResult(future, std::chrono::milliseconds(100), success) && success;
 }
 
-inline uintptr_t mem::findPattern(uintptr_t start, uintptr_t size, const std::string& pattern) {
-    if (!g_WebSocketServer.is_connected() || !activeProcess) {
+// Walks the range one background find_pattern request at a time, interactive reads get the link
+// between chunks. Chunks overlap by the pattern length so a match across a boundary isn't missed.
+inline std::future<uintptr_t> mem::findPatternAsync(uintptr_t start, uintptr_t size, const std::string& pattern) {
+    auto scan = std::make_shared<patternScan>();
+    std::future<uintptr_t> future = scan->promise.get_future();
+
+    if (!g_Bridge.is_connected() || !activeProcess) {
         logger::addLog("[Memory] Cannot scan - not connected or no process");
-        return 0;
+        scan->promise.set_value(0);
+        return future;
     }
 
     logger::addLog("[Memory] Scanning for pattern: " + pattern);
 
-    std::promise<uintptr_t> promise;
-    std::future<uintptr_t> future = promise.get_future();
+    // IDA signature, one space separated token per byte
+    size_t patternBytes = 0;
+    for (size_t i = 0; i < pattern.size(); i++) {
+        if (pattern[i] != ' ' && (i == 0 || pattern[i - 1] == ' ')) {
+            patternBytes++;
+        }
+    }
+
+    scan->next = start;
+    scan->end = start + size;
+    scan->overlap = patternBytes ? (std::min)(uintptr_t(patternBytes - 1), PATTERN_CHUNK_SIZE / 2) : 0;
+    scan->pattern = pattern;
+
+    scanPatternChunk(std::move(scan));
+    return future;
+}
+
+inline void mem::scanPatternChunk(std::shared_ptr<patternScan> scan) {
+    if (!g_Bridge.is_connected() || !activeProcess) {
+        scan->promise.set_value(0);
+        return;
+    }
+
+    uintptr_t chunk = (std::min)(PATTERN_CHUNK_SIZE, scan->end - scan->next);
 
     json data;
-    data["start"] = std::to_string(start);
-    data["size"] = std::to_string(size);
-    data["pattern"] = pattern;
+    data["start"] = std::to_string(scan->next);
+    data["size"] = std::to_string(chunk);
+    data["pattern"] = scan->pattern;
 
-    g_WebSocketServer.send_request("find_pattern", data,
-        [&promise](const std::string& response) {
+    g_Bridge.send_request("find_pattern", data,
+        [scan, chunk](std::string_view response) {
             try {
                 auto j = json::parse(response);
 
-                if (j.contains("success") && j["success"].get<bool>()) {
-                    std::string addr_str = j["address"].get<std::string>();
-                    uintptr_t result = std::stoull(addr_str, nullptr, 16);
-                    promise.set_value(result);
+                if (!j.contains("success") || !j["success"].get<bool>()) {
+                    scan->promise.set_value(0);
+                    return;
                 }
-                else {
-                    promise.set_value(0);
+
+                uintptr_t result = std::stoull(j["address"].get<std::string>(), nullptr, 16);
+                if (result || scan->next + chunk >= scan->end) {
+                    scan->promise.set_value(result);
+                    return;
                 }
             }
             catch (const std::exception& e) {
                 logger::addLog("[Memory] find_pattern error: " + std::string(e.what()));
-                promise.set_value(0);
+                scan->promise.set_value(0);
+                return;
             }
-        });
 
-    if (future.wait_for(std::chrono::seconds(5)) == std::future_status::ready) {
-        return future.get();
+            scan->next += chunk - scan->overlap;
+            scanPatternChunk(scan);
+        }, priority_background);
+}
+
+inline uintptr_t mem::findPattern(uintptr_t start, uintptr_t size, const std::string& pattern) {
+    auto future = findPatternAsync(start, size, pattern);
+
+    uintptr_t result = 0;
+    if (waitResult(future, std::chrono::seconds(30), result)) {
+        return result;
     }
 
     logger::addLog("[Memory] Pattern scan timeout");
     return 0;
 }
 
+inline uintptr_t mem::pointerSize() {
+    return x32 ? 4 : 8;
+}
+
+inline std::future<pointerChain> mem::readPointerChainAsync(uintptr_t base, std::vector<int64_t> offsets, uintptr_t size,
+    requestPriority priority) {
+    auto walk = std::make_shared<chainWalk>();
+    walk->size = size;
+    walk->priority = priority;
+    walk->current = base;
+    walk->chain.addresses.resize(offsets.size());
+    walk->offsets = std::move(offsets);
+    auto future = walk->promise.get_future();
+
+    if (walk->offsets.empty() || !g_Bridge.is_connected() || !activeProcess) {
+        walk->promise.set_value(std::move(walk->chain));
+        return future;
+    }
+
+    size_t depth = walk->offsets.size();
+    size_t replySize = sizeof(protocol::chainReply) + depth * sizeof(uint64_t) + size;
+    if (!g_Bridge.supports(protocol::op_deref_chain) || depth > protocol::maxChainDepth || replySize > g_Bridge.max_payload()) {
+        walkPointerChain(walk);
+        return future;
+    }
+
+    protocol::chainRequest request{};
+    request.size = static_cast<uint32_t>(size);
+    request.pointerSize = static_cast<uint8_t>(pointerSize());
+    request.depth = static_cast<uint8_t>(depth);
+
+    std::vector<uint8_t> payload(sizeof(request) + depth * sizeof(int64_t));
+    memcpy(payload.data(), &request, sizeof(request));
+    memcpy(payload.data() + sizeof(request), walk->offsets.data(), depth * sizeof(int64_t));
+
+    g_Bridge.send_binary_request(protocol::op_deref_chain, base, static_cast<uint32_t>(payload.size()), payload.data(), payload.size(),
+        [walk, depth](bool success, const uint8_t* bytes, size_t length) {
+            auto& chain = walk->chain;
+            protocol::chainReply reply{};
+            size_t header = sizeof(reply) + depth * sizeof(uint64_t);
+            if (success && length >= header) {
+                memcpy(&reply, bytes, sizeof(reply));
+                for (size_t i = 0; i < depth; i++) {
+                    uint64_t address = 0;
+                    memcpy(&address, bytes + sizeof(reply) + i * sizeof(address), sizeof(address));
+                    chain.addresses[i] = static_cast<uintptr_t>(address);
+                }
+
+                chain.resolved = (std::min)(size_t(reply.resolved), depth);
+                if (chain.resolved == depth && reply.length == walk->size && length - header >= reply.length) {
+                    chain.data.assign(bytes + header, bytes + header + reply.length);
+                    chain.success = true;
+                }
+            }
+            walk->promise.set_value(std::move(chain));
+        }, priority);
+
+    return future;
+}
+
+// Fallback for bridges without deref_chain, every level is a read of its own
+inline void mem::walkPointerChain(std::shared_ptr<chainWalk> walk) {
+    size_t level = walk->chain.resolved;
+    bool last = level + 1 == walk->offsets.size();
+    uintptr_t size = last ? walk->size : pointerSize();
+
+    uintptr_t address = walk->current + static_cast<uintptr_t>(walk->offsets[level]);
+    if (x32) {
+        address &= 0xFFFFFFFF;
+    }
+    walk->chain.addresses[level] = address;
+
+    requestRead(address, size,
+        [walk, last, size](bool success, const uint8_t* bytes, size_t length) {
+            auto& chain = walk->chain;
+            if (!success || length < size) {
+                walk->promise.set_value(std::move(chain));
+                return;
+            }
+
+            chain.resolved++;
+            if (last) {
+                chain.data.assign(bytes, bytes + size);
+                chain.success = true;
+                walk->promise.set_value(std::move(chain));
+                return;
+            }
+
+            uintptr_t next = 0;
+            memcpy(&next, bytes, size);
+            walk->current = next;
+            walkPointerChain(walk);
+        }, walk->priority);
+}
+
+// Blocking wrapper around readPointerChainAsync, chain gets the level addresses even when the walk broke off
+inline bool mem::readPointerChain(uintptr_t base, const std::vector<int64_t>& offsets, void* buf, uintptr_t size, pointerChain* chain) {
+    auto future = readPointerChainAsync(base, offsets, size);
+
+    pointerChain result;
+    if (!waitResult(future, std::chrono::milliseconds(100), result)) {
+        return false;
+    }
+
+    if (result.success && result.data.size() >= size) {
+        memcpy(buf, result.data.data(), size);
+    }
+    bool success = result.success;
+    if (chain) {
+        *chain = std::move(result);
+    }
+    return success;
+}
+
+inline std::future<std::vector<gatherEntry>> mem::gatherAsync(uintptr_t base, uint32_t count, uint32_t stride, int32_t offset,
+    uintptr_t size, requestPriority priority, std::chrono::milliseconds deadline) {
+    struct gatherState {
+        std::mutex mutex;
+        std::vector<gatherEntry> entries;
+        size_t remaining = 0;
+        std::promise<std::vector<gatherEntry>> promise;
+    };
+
+    auto state = std::make_shared<gatherState>();
+    auto future = state->promise.get_future();
+    state->entries.resize(count);
+
+    const uintptr_t width = pointerSize();
+    if (!count || stride < width || !g_Bridge.is_connected() || !activeProcess) {
+        state->promise.set_value(std::move(state->entries));
+        return future;
+    }
+
+    // a pointer, its flag and its block per element, the array read has to fit as well
+    const size_t perElement = sizeof(uint64_t) + 1 + size;
+    const size_t maxPayload = g_Bridge.max_payload();
+    const size_t chunk = (std::min)(maxPayload / perElement, maxPayload / stride);
+
+    if (g_Bridge.supports(protocol::op_gather) && chunk) {
+        state->remaining = (count + chunk - 1) / chunk;
+
+        for (size_t first = 0; first < count; first += chunk) {
+            protocol::gatherRequest request{};
+            request.count = static_cast<uint32_t>((std::min)(chunk, size_t(count) - first));
+            request.stride = stride;
+            request.offset = offset;
+            request.size = static_cast<uint32_t>(size);
+            request.pointerSize = static_cast<uint8_t>(width);
+
+            g_Bridge.send_binary_request(protocol::op_gather, base + first * stride, sizeof(request), &request, sizeof(request),
+                [state, first, elements = size_t(request.count), size](bool success, const uint8_t* bytes, size_t length) {
+                    std::lock_guard<std::mutex> lock(state->mutex);
+                    if (success && length >= elements * (sizeof(uint64_t) + 1 + size)) {
+                        const uint8_t* flags = bytes + elements * sizeof(uint64_t);
+                        const uint8_t* blocks = flags + elements;
+                        for (size_t i = 0; i < elements; i++) {
+                            auto& entry = state->entries[first + i];
+                            uint64_t pointer = 0;
+                            memcpy(&pointer, bytes + i * sizeof(pointer), sizeof(pointer));
+                            entry.pointer = static_cast<uintptr_t>(pointer);
+                            entry.valid = flags[i] != 0;
+                            if (entry.valid) {
+                                entry.data.assign(blocks + i * size, blocks + (i + 1) * size);
+                            }
+                        }
+                    }
+
+                    if (--state->remaining == 0) {
+                        state->promise.set_value(std::move(state->entries));
+                    }
+                }, priority, deadline);
+        }
+        return future;
+    }
+
+    // no gather op, the array first and then every target in one batch
+    requestRead(base, uintptr_t(count) * stride,
+        [state, count, stride, offset, size, width, priority, deadline](bool success, const uint8_t* bytes, size_t length) {
+            if (!success || length < size_t(count) * stride) {
+                state->promise.set_value(std::move(state->entries));
+                return;
+            }
+
+            std::vector<readRange> targets;
+            std::vector<size_t> owners;
+            for (size_t i = 0; i < count; i++) {
+                auto& entry = state->entries[i];
+                memcpy(&entry.pointer, bytes + i * stride, width);
+                if (entry.pointer) {
+                    targets.push_back({ entry.pointer + static_cast<intptr_t>(offset), size });
+                    owners.push_back(i);
+                }
+            }
+
+            if (targets.empty()) {
+                state->promise.set_value(std::move(state->entries));
+                return;
+            }
+
+            state->remaining = targets.size();
+            for (size_t t = 0; t < targets.size(); t++) {
+                g_ReadCoalescer.read(targets[t].address, size, priority, deadline,
+                    [state, owner = owners[t], size](bool success, const uint8_t* bytes, size_t length) {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        auto& entry = state->entries[owner];
+                        entry.valid = success && length >= size;
+                        if (entry.valid) {
+                            entry.data.assign(bytes, bytes + size);
+                        }
+
+                        if (--state->remaining == 0) {
+                            state->promise.set_value(std::move(state->entries));
+                        }
+                    });
+            }
+            g_ReadCoalescer.flush();
+        }, priority, deadline);
+
+    return future;
+}
+
+// Blocking wrapper around gatherAsync. Returns false on timeout, out has an entry per element either way.
+inline bool mem::gather(uintptr_t base, uint32_t count, uint32_t stride, int32_t offset, uintptr_t size, std::vector<gatherEntry>& out,
+    requestPriority priority) {
+    auto future = gatherAsync(base, count, stride, offset, size, priority);
+
+    if (!waitResult(future, std::chrono::milliseconds(100), out) || out.size() != count) {
+        out.assign(count, gatherEntry{});
+        return false;
+    }
+    return true;
+}
+
+inline size_t mem::prefetchTargets(const uint8_t* data, size_t size, size_t budget) {
+    uintptr_t width = pointerSize();
+    // user mode pointers only, anything below the first 64 KiB is a small integer
+    uintptr_t highest = x32 ? 0xFFFFFFFF : 0x7FFFFFFFFFFF;
+
+    std::unordered_set<uintptr_t> seen;
+    size_t issued = 0;
+    for (size_t offset = 0; offset + width <= size && issued < budget; offset += width) {
+        uintptr_t value = 0;
+        memcpy(&value, data + offset, width);
+        if (value < 0x10000 || value > highest || value % width || !seen.insert(value).second) {
+            continue;
+        }
+
+        // a target the bridge couldn't read is a negative entry for a while (unless the window straddles
+        // two pages), so garbage that only looks like a pointer is mostly tried once a second at most
+        uintptr_t start = value - PREFETCH_BEFORE;
+        if (g_MemoryCache.peek(start, PREFETCH_BEFORE + PREFETCH_AFTER, PREFETCH_MAX_AGE) != MemoryCache::cache_miss) {
+            continue;
+        }
+
+        // nobody waits on it, the reply fills the cache on its way in
+        requestRead(start, PREFETCH_BEFORE + PREFETCH_AFTER, [](bool, const uint8_t*, size_t) {}, priority_background, PREFETCH_DEADLINE);
+        issued++;
+    }
+
+    g_Prefetched += issued;
+    return issued;
+}
+
 template <typename T>
 T Read(uintptr_t address) {
     T response{};
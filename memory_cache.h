@@ -0,0 +1,392 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Target memory as last read, in PAGE_BYTES pages. Everything read from the bridge lands here and a
+// read is served from whatever pages cover it, so one that straddles two classes or lands on a pointer
+// target hits as long as those bytes were fetched by anyone. Reads rarely cover whole pages, each page
+// keeps the spans of it that hold data. Pages remember when they were last filled, pages the bridge
+// couldn't read are kept for a while as negative entries, and the least recently used pages are dropped
+// once the cache is over its byte budget.
+//
+// Readers that must not block (the UI) don't go through the mutex at all: the memory thread publishes
+// an immutable Generation of the cache after every pass and a reader pins the current one. Pages are
+// copy-on-write, a page a generation still holds is copied before the next store touches it, so
+// publishing only copies pointers and a pinned generation never changes under its reader.
+class MemoryCache {
+public:
+    static constexpr uintptr_t PAGE_BYTES = 4096;
+    static constexpr size_t DEFAULT_BUDGET = 64 * 1024 * 1024;
+    // how long an unreadable page is believed before the next read may try it again
+    static constexpr std::chrono::milliseconds NEGATIVE_TTL{ 1000 };
+
+    enum lookup : uint8_t {
+        cache_miss,
+        cache_hit,
+        cache_unreadable,   // part of the range is on a page the bridge couldn't read
+    };
+
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t unreadable = 0;    // lookups answered by a negative entry
+        uint64_t evictions = 0;     // pages dropped for the budget
+        size_t pages = 0;
+        size_t negativePages = 0;
+        size_t bytes = 0;
+        size_t budget = 0;
+        uint64_t generation = 0;    // serial of the last published generation
+    };
+
+private:
+    // a negative entry has no data, this is what it's charged against the budget
+    static constexpr size_t NEGATIVE_COST = 64;
+
+    struct Span {
+        uint16_t begin;
+        uint16_t end;
+    };
+
+    struct Image {
+        std::vector<uint8_t> data;  // PAGE_BYTES, empty for a negative entry
+        std::vector<Span> spans;    // sorted, never touching each other
+        std::chrono::steady_clock::time_point filled;
+        std::chrono::steady_clock::time_point expires;  // negative entries only, believed until then
+    };
+
+    struct Page {
+        std::shared_ptr<Image> image;
+        std::list<uintptr_t>::iterator lru;
+    };
+
+public:
+    // The cache as it was at one publish. Immutable, any number of threads can read one without locking.
+    class Generation {
+    private:
+        friend class MemoryCache;
+
+        // sorted by page base, one allocation per publish
+        std::vector<std::pair<uintptr_t, std::shared_ptr<const Image>>> pages;
+        uint64_t serial = 0;
+
+    public:
+        uint64_t id() const {
+            return serial;
+        }
+
+        // Same answers as MemoryCache::read as of the publish, without the counters. A negative entry
+        // still runs out when it would have in the cache itself.
+        lookup read(uintptr_t address, void* out, size_t size) const {
+            if (!size) {
+                return cache_miss;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+
+            uintptr_t end = address + size;
+            uintptr_t base = address & ~(PAGE_BYTES - 1);
+            auto it = std::lower_bound(pages.begin(), pages.end(), base,
+                [](const auto& entry, uintptr_t at) { return entry.first < at; });
+
+            auto first = it;
+            for (uintptr_t at = base; at < end; at += PAGE_BYTES, ++it) {
+                if (it == pages.end() || it->first != at) {
+                    return cache_miss;
+                }
+
+                const Image& image = *it->second;
+                if (image.data.empty()) {
+                    return now < image.expires ? cache_unreadable : cache_miss;
+                }
+
+                uintptr_t from = (std::max)(address, at) - at;
+                uintptr_t to = (std::min)(end, at + PAGE_BYTES) - at;
+                if (!contains(image, from, to)) {
+                    return cache_miss;
+                }
+            }
+
+            it = first;
+            for (uintptr_t at = base; at < end; at += PAGE_BYTES, ++it) {
+                uintptr_t from = (std::max)(address, at);
+                uintptr_t to = (std::min)(end, at + PAGE_BYTES);
+                memcpy(static_cast<uint8_t*>(out) + (from - address), it->second->data.data() + (from - at), to - from);
+            }
+            return cache_hit;
+        }
+    };
+
+private:
+    std::mutex mutex;
+    std::map<uintptr_t, Page> pages;
+    std::list<uintptr_t> lru;   // page bases, most recently used first
+    size_t bytes = 0;
+    size_t budget = DEFAULT_BUDGET;
+    Stats counters;
+
+    std::atomic<std::shared_ptr<const Generation>> published{ std::make_shared<const Generation>() };
+    // anything changed since the last publish
+    bool dirty = false;
+
+    static size_t cost(const Page& page) {
+        return page.image->data.empty() ? NEGATIVE_COST : PAGE_BYTES;
+    }
+
+    static bool contains(const Image& image, uintptr_t begin, uintptr_t end) {
+        for (auto& span : image.spans) {
+            if (span.begin <= begin && end <= span.end) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void addSpan(std::vector<Span>& spans, uintptr_t begin, uintptr_t end) {
+        Span added{ static_cast<uint16_t>(begin), static_cast<uint16_t>(end) };
+
+        // fold in everything it overlaps or touches, the rest stays sorted around it
+        auto first = std::find_if(spans.begin(), spans.end(), [&](const Span& span) { return span.end >= added.begin; });
+        auto last = first;
+        while (last != spans.end() && last->begin <= added.end) {
+            added.begin = (std::min)(added.begin, last->begin);
+            added.end = (std::max)(added.end, last->end);
+            ++last;
+        }
+        first = spans.erase(first, last);
+        spans.insert(first, added);
+    }
+
+    void touch(Page& page) {
+        lru.splice(lru.begin(), lru, page.lru);
+    }
+
+    void erase(std::map<uintptr_t, Page>::iterator it) {
+        bytes -= cost(it->second);
+        lru.erase(it->second.lru);
+        pages.erase(it);
+        dirty = true;
+    }
+
+    // The page at base, ready to be changed. One a published generation still shares is copied first.
+    Image& obtain(uintptr_t base) {
+        auto [it, inserted] = pages.try_emplace(base);
+        Page& page = it->second;
+        if (inserted) {
+            page.image = std::make_shared<Image>();
+            lru.push_front(base);
+            page.lru = lru.begin();
+            bytes += NEGATIVE_COST;
+        }
+        else {
+            touch(page);
+            if (page.image.use_count() > 1) {
+                page.image = std::make_shared<Image>(*page.image);
+            }
+        }
+        dirty = true;
+        return *page.image;
+    }
+
+    void evict() {
+        while (bytes > budget && !lru.empty()) {
+            erase(pages.find(lru.back()));
+            counters.evictions++;
+        }
+    }
+
+    // Whether every byte of the range is cached (and young enough), an expired negative entry is dropped
+    lookup check(uintptr_t address, uintptr_t end, std::chrono::milliseconds maxAge, std::chrono::steady_clock::time_point now) {
+        // one lookup, the following pages are the next entries if they're cached at all
+        uintptr_t base = address & ~(PAGE_BYTES - 1);
+        auto it = pages.lower_bound(base);
+        for (uintptr_t at = base; at < end; at += PAGE_BYTES, ++it) {
+            if (it == pages.end() || it->first != at) {
+                return cache_miss;
+            }
+
+            const Image& image = *it->second.image;
+            if (image.data.empty()) {
+                if (now < image.expires) {
+                    return cache_unreadable;
+                }
+                erase(it);
+                return cache_miss;
+            }
+
+            uintptr_t from = (std::max)(address, at) - at;
+            uintptr_t to = (std::min)(end, at + PAGE_BYTES) - at;
+            if (!contains(image, from, to) || (maxAge.count() && now - image.filled > maxAge)) {
+                return cache_miss;
+            }
+        }
+        return cache_hit;
+    }
+
+public:
+    // Copies [address, address + size) out of the cache. A hit needs every byte cached, and with maxAge
+    // set every page involved filled no longer ago than that. out is left alone on anything but a hit.
+    lookup read(uintptr_t address, void* out, size_t size, std::chrono::milliseconds maxAge = {}) {
+        if (!size) {
+            return cache_miss;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        uintptr_t end = address + size;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        lookup result = check(address, end, maxAge, now);
+        if (result != cache_hit) {
+            (result == cache_unreadable ? counters.unreadable : counters.misses)++;
+            return result;
+        }
+
+        // everything's there, copy it out page by page
+        uintptr_t base = address & ~(PAGE_BYTES - 1);
+        auto it = pages.find(base);
+        for (uintptr_t at = base; at < end; at += PAGE_BYTES, ++it) {
+            uintptr_t from = (std::max)(address, at);
+            uintptr_t to = (std::min)(end, at + PAGE_BYTES);
+            memcpy(static_cast<uint8_t*>(out) + (from - address), it->second.image->data.data() + (from - at), to - from);
+            touch(it->second);
+        }
+
+        counters.hits++;
+        return cache_hit;
+    }
+
+    // Same answer as read without copying anything or counting it, for deciding whether to fetch a range
+    lookup peek(uintptr_t address, size_t size, std::chrono::milliseconds maxAge = {}) {
+        if (!size) {
+            return cache_miss;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return check(address, address + size, maxAge, std::chrono::steady_clock::now());
+    }
+
+    // Caches bytes just read at address. Pages that were negative become regular pages again.
+    void store(uintptr_t address, const uint8_t* data, size_t size) {
+        if (!size) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        uintptr_t end = address + size;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (uintptr_t at = address & ~(PAGE_BYTES - 1); at < end; at += PAGE_BYTES) {
+            Image& image = obtain(at);
+            if (image.data.empty()) {
+                image.data.resize(PAGE_BYTES);
+                image.spans.clear();
+                bytes += PAGE_BYTES - NEGATIVE_COST;
+            }
+
+            uintptr_t from = (std::max)(address, at);
+            uintptr_t to = (std::min)(end, at + PAGE_BYTES);
+            memcpy(image.data.data() + (from - at), data + (from - address), to - from);
+            addSpan(image.spans, from - at, to - at);
+            image.filled = now;
+        }
+
+        evict();
+    }
+
+    // The bridge failed to read the range. Only a range inside one page says anything about that page,
+    // one straddling pages may have failed on a single unmapped neighbour, so it leaves no trace. The page
+    // becomes a negative entry if it holds nothing yet, one that has data keeps it.
+    void markUnreadable(uintptr_t address, size_t size) {
+        uintptr_t base = address & ~(PAGE_BYTES - 1);
+        if (!size || ((address + size - 1) & ~(PAGE_BYTES - 1)) != base) {
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Image& image = obtain(base);
+        if (image.data.empty()) {
+            image.filled = now;
+            image.expires = now + NEGATIVE_TTL;
+        }
+
+        evict();
+    }
+
+    // Forgets the pages a range touches
+    void invalidate(uintptr_t address, size_t size) {
+        uintptr_t end = address + size;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pages.lower_bound(address & ~(PAGE_BYTES - 1));
+        while (it != pages.end() && it->first < end) {
+            erase(it++);
+        }
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        pages.clear();
+        lru.clear();
+        bytes = 0;
+        dirty = true;
+    }
+
+    void setBudget(size_t limit) {
+        std::lock_guard<std::mutex> lock(mutex);
+        budget = limit;
+        evict();
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats result = counters;
+        result.pages = pages.size();
+        result.bytes = bytes;
+        result.budget = budget;
+        result.generation = pinned()->id();
+        for (auto& [base, page] : pages) {
+            result.negativePages += page.image->data.empty();
+        }
+        return result;
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters = {};
+    }
+
+    // Makes the cache as it is now what pinned() hands out. Nothing happens if it hasn't changed.
+    void publish() {
+        auto next = std::make_shared<Generation>();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!dirty) {
+                return;
+            }
+            dirty = false;
+
+            next->serial = published.load()->serial + 1;
+            next->pages.reserve(pages.size());
+            for (auto& [base, page] : pages) {
+                next->pages.emplace_back(base, page.image);
+            }
+        }
+        published.store(std::move(next));
+    }
+
+    // The last published generation, it stays valid for as long as the caller holds on to it
+    std::shared_ptr<const Generation> pinned() const {
+        return published.load();
+    }
+};
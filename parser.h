@@ -10,7 +10,18 @@ namespace ui {
 }
 
 namespace addressParser {
+	// An expression's value while parsing. [x] reads a pointer at x, nested reads pile up here so the
+	// whole expression resolves with one pointer chain read at the end
+	struct chainValue {
+		uintptr_t base = 0;
+		std::vector<int64_t> offsets;	// each is added, then a pointer is read there
+		uintptr_t add = 0;				// added after the last read
+	};
+
 	uintptr_t parseExport(const std::string& expression);
+	uintptr_t parseTerm(const std::string& token);
+	chainValue parseChain(const std::string& expression);
+	uintptr_t resolveChain(const chainValue& chain);
 	uintptr_t parseInput(const char* str);
 }
 
@@ -30,19 +41,49 @@ inline uintptr_t addressParser::parseExport(const std::string& expression)
 	return 0;
 }
 
-inline uintptr_t addressParser::parseInput(const char* str) {
-	std::string expression(str);
-	uintptr_t rtn = 0;
+inline uintptr_t addressParser::parseTerm(const std::string& curToken) {
+	if (curToken.find('!') != std::string::npos) {
+		return parseExport(curToken);
+	}
+
+	for (const std::string& ending : g_fileEndings) {
+		if (curToken.find(ending) != std::string::npos) {
+			// Use cached module list instead of getModuleInfo
+			for (const auto& mod : mem::moduleList) {
+				if (mod.name == curToken) {
+					return mod.base;
+				}
+			}
+			break; // break out of file endings loop
+		}
+	}
+
+	std::string hex = curToken;
+	if (ui::isValidHex(hex)) {
+		return ui::toAddress(hex);
+	}
+	return 0;
+}
+
+inline addressParser::chainValue addressParser::parseChain(const std::string& expression) {
+	chainValue rtn;
 	std::vector<std::string> tokens;
 	std::vector<char> operators;
 
 	{ // separating scope to avoid confusion with token naming
 		size_t lastPos = 0;
+		int depth = 0;
 		std::string token;
 		for (size_t pos = 0; pos < expression.length(); pos++)
 		{
 			char posToken = expression[pos];
-			if (posToken == '+' || posToken == '-')
+			if (posToken == '[') {
+				depth++;
+			}
+			else if (posToken == ']') {
+				depth--;
+			}
+			else if ((posToken == '+' || posToken == '-') && depth == 0)
 			{
 				token = expression.substr(lastPos, pos - lastPos);
 				tokens.push_back(token);
@@ -68,49 +109,55 @@ inline uintptr_t addressParser::parseInput(const char* str) {
 			curToken = ""; // all spaces maybe?
 		}
 
-		uintptr_t value = 0;
-
-		if (curToken.find('!') != std::string::npos) {
-			value = parseExport(curToken);
+		chainValue value;
+		if (curToken.size() >= 2 && curToken.front() == '[' && curToken.back() == ']') {
+			// the pointer read at inner's address becomes one more level of its chain
+			chainValue inner = parseChain(curToken.substr(1, curToken.size() - 2));
+			value.base = inner.base;
+			value.offsets = std::move(inner.offsets);
+			value.offsets.push_back(static_cast<int64_t>(inner.add));
 		}
 		else {
-			bool isModule = false;
-			for (const std::string& ending : g_fileEndings) {
-				if (curToken.find(ending) != std::string::npos) {
-					// Use cached module list instead of getModuleInfo
-					for (const auto& mod : mem::moduleList) {
-						if (mod.name == curToken) {
-							value = mod.base;
-							isModule = true;
-							break;
-						}
-					}
-					break; // break out of file endings loop
-				}
-			}
-
-			if (!isModule) {
-				if (ui::isValidHex(curToken)) {
-					value = ui::toAddress(curToken);
-				}
-				else {
-					value = 0;
-				}
-			}
+			value.base = parseTerm(curToken);
 		}
 
 		if (iterator == 0) {
-			rtn = value;
+			rtn = std::move(value);
 		}
 		else {
-			if (operators[iterator - 1] == '+') {
-				rtn += value;
+			bool subtract = operators[iterator - 1] == '-';
+
+			// only one side can stay a chain, anything else gets read now
+			if (!value.offsets.empty() && (subtract || !rtn.offsets.empty())) {
+				value = { resolveChain(value) };
+			}
+
+			if (value.offsets.empty()) {
+				uintptr_t number = value.base + value.add;
+				rtn.add = subtract ? rtn.add - number : rtn.add + number;
 			}
-			else if (operators[iterator - 1] == '-') {
-				rtn -= value;
+			else {
+				value.add += rtn.base + rtn.add;
+				rtn = std::move(value);
 			}
 		}
 		iterator++;
 	}
 	return rtn;
-}
\ No newline at end of file
+}
+
+inline uintptr_t addressParser::resolveChain(const chainValue& chain) {
+	if (chain.offsets.empty()) {
+		return chain.base + chain.add;
+	}
+
+	uintptr_t pointer = 0;
+	if (!mem::readPointerChain(chain.base, chain.offsets, &pointer, mem::pointerSize())) {
+		return 0;
+	}
+	return pointer + chain.add;
+}
+
+inline uintptr_t addressParser::parseInput(const char* str) {
+	return resolveChain(parseChain(str));
+}
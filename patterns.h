@@ -44,6 +44,8 @@ namespace pattern
 	std::string stringToSignature(const std::string& in);
 	std::optional<PatternInfo> detectPatternType(const std::string& in);
 	std::optional<PatternScanResult> scanPattern(PatternInfo& patternInfo, const std::string& dllName, std::optional<PatternType> patternType);
+	std::future<uintptr_t> scanPatternAsync(PatternInfo& patternInfo, const std::string& dllName, std::optional<PatternType> patternType);
+	std::optional<PatternScanResult> toScanResult(uintptr_t address);
 	std::optional<PatternScanResult> findBytePattern(uintptr_t baseAddress, size_t size, const uint8_t* signature, const char* mask);
 	bool patternToMask(const PatternInfo& patternInfo, std::vector<uint8_t>& outBytes, std::string& outMask);
 }
@@ -209,7 +211,8 @@ inline std::optional<PatternScanResult> pattern::findBytePattern(uintptr_t baseA
 }
 
 
-inline std::optional<PatternScanResult> pattern::scanPattern(PatternInfo& patternInfo, const std::string& dllName, std::optional<PatternType> inputPatternType = std::nullopt)
+// Returns an invalid future if the scan couldn't be started
+inline std::future<uintptr_t> pattern::scanPatternAsync(PatternInfo& patternInfo, const std::string& dllName, std::optional<PatternType> inputPatternType = std::nullopt)
 {
 	if (inputPatternType != std::nullopt) {
 		auto patternType = detectPatternType(patternInfo.pattern);
@@ -220,7 +223,7 @@ inline std::optional<PatternScanResult> pattern::scanPattern(PatternInfo& patter
 	}
 
 	if (!mem::g_pid)
-		return std::nullopt;
+		return {};
 
 	// Find module in cached list instead of calling getModuleInfo
 	moduleInfo* moduleData = nullptr;
@@ -233,7 +236,7 @@ inline std::optional<PatternScanResult> pattern::scanPattern(PatternInfo& patter
 
 	if (!moduleData) {
 		logger::addLog("[Pattern] Module not found in cache: " + dllName);
-		return std::nullopt;
+		return {};
 	}
 
 	// Convert pattern to IDA signature format for Perception
@@ -249,7 +252,7 @@ inline std::optional<PatternScanResult> pattern::scanPattern(PatternInfo& patter
 		std::string mask;
 
 		if (!patternToMask(patternInfo, patternBytes, mask)) {
-			return std::nullopt;
+			return {};
 		}
 
 		// Build IDA signature: "48 8B ?? ??" etc
@@ -267,21 +270,37 @@ inline std::optional<PatternScanResult> pattern::scanPattern(PatternInfo& patter
 		}
 	}
 	else {
-		return std::nullopt;
+		return {};
 	}
 
 	logger::addLog("[Pattern] Scanning in " + dllName + " for: " + ida_pattern);
 
 	// Use remote pattern scanner via WebSocket
-	uintptr_t result = mem::findPattern(moduleData->base, moduleData->size, ida_pattern);
+	return mem::findPatternAsync(moduleData->base, moduleData->size, ida_pattern);
+}
 
-	if (result != 0) {
+inline std::optional<PatternScanResult> pattern::toScanResult(uintptr_t address)
+{
+	if (address != 0) {
 		PatternScanResult scanResult;
-		scanResult.matches.push_back(result);
-		logger::addLog("[Pattern] Found at: 0x" + ui::toHexString(result, 16));
+		scanResult.matches.push_back(address);
+		logger::addLog("[Pattern] Found at: 0x" + ui::toHexString(address, 16));
 		return scanResult;
 	}
 
 	logger::addLog("[Pattern] Not found");
 	return std::nullopt;
+}
+
+inline std::optional<PatternScanResult> pattern::scanPattern(PatternInfo& patternInfo, const std::string& dllName, std::optional<PatternType> inputPatternType = std::nullopt)
+{
+	auto future = scanPatternAsync(patternInfo, dllName, inputPatternType);
+
+	uintptr_t result = 0;
+	if (!mem::waitResult(future, std::chrono::seconds(30), result)) {
+		logger::addLog("[Pattern] Scan timeout");
+		return std::nullopt;
+	}
+
+	return toScanResult(result);
 }
\ No newline at end of file
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <cstdint>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary frame layout shared with imclass_server.as, all fields little-endian.
+// JSON stays in use for control messages (ref_process, get_modules, find_pattern, hello),
+// memory traffic goes through these frames once the bridge advertises support in its hello.
+namespace protocol {
+    // Bumped whenever an op or hello field is added. Bridges that predate the handshake don't send a version
+    // and are treated as version 1.
+    inline constexpr uint32_t version = 6;
+
+    enum frameOp : uint8_t {
+        op_rvm = 1,     // address + length to read, response payload is the raw bytes
+        op_wvm = 2,     // address + raw bytes to write, response carries no payload
+        op_rvm_batch = 3,   // payload is a rangeCount followed by batchRange entries, response is [u32 length][bytes] per range
+        op_subscribe = 4,   // address + subscribeRequest, the bridge re-reads the range on its own tick
+        op_unsubscribe = 5, // payload is the u32 subscription id
+        op_push = 6,        // bridge -> ImClass only, requestId is the subscription id, payload is [u32 sequence][bytes]
+        op_resync = 7,      // payload is the u32 subscription id, the next push carries the whole range
+        op_deref_chain = 8, // address is the base, payload is a chainRequest and its offsets, response is a chainReply
+        op_gather = 9,      // address is a pointer array, payload is a gatherRequest, see there for the response
+    };
+
+    inline constexpr uint8_t knownOps[] = { op_rvm, op_wvm, op_rvm_batch, op_subscribe, op_unsubscribe, op_resync, op_deref_chain, op_gather };
+
+    enum frameFlags : uint8_t {
+        flag_response = 1 << 0,
+        flag_error = 1 << 1,
+        flag_push = 1 << 2,     // unsolicited, not the answer to a request
+        flag_delta = 1 << 3,    // push payload is a delta against the previous push, see applyDelta
+        flag_compressed = 1 << 4,   // payload is [u32 raw length][lz block], see lz.h
+    };
+
+#pragma pack(push, 1)
+    struct frameHeader {
+        uint8_t op;
+        uint8_t flags;
+        uint16_t reserved;
+        uint32_t requestId;
+        uint64_t address;
+        uint32_t length;    // payload size, or the requested size for op_rvm requests
+    };
+
+    struct batchRange {
+        uint64_t address;
+        uint32_t size;
+    };
+
+    // A push carries the whole range whenever it differs from the last one sent, the sequence counts
+    // pushes per subscription starting at 1
+    struct subscribeRequest {
+        uint32_t subscriptionId;
+        uint32_t size;
+        uint32_t intervalMs;
+    };
+
+    // Delta pushes (sessions with the "delta" feature) carry a list of these after the sequence, each
+    // followed by count bytes: skip bytes are unchanged, the next count get XORed into the previous
+    // version. Only sent when it's smaller than the range itself, and never for the first push or one
+    // after a resync.
+    struct deltaRun {
+        uint32_t skip;
+        uint32_t count;
+    };
+
+    // Pointer walk done by the bridge in one round trip. Each level adds its offset (i64, depth of them
+    // follow) to the current address and reads a pointerSize pointer there, the last level reads size
+    // bytes instead. So base, { 0x10, 0x28, 0x8 } with size 8 is [[[base+0x10]+0x28]+0x8].
+    inline constexpr size_t maxChainDepth = 32;
+
+    struct chainRequest {
+        uint32_t size;
+        uint8_t pointerSize;
+        uint8_t depth;
+        uint16_t reserved;
+    };
+
+    // Followed by depth u64 level addresses, then length bytes (size, or 0 unless every level was read).
+    // resolved counts the levels that could be read, the first resolved + 1 addresses are valid.
+    struct chainReply {
+        uint32_t resolved;
+        uint32_t length;
+    };
+
+    // Entity-list style read: count pointers of pointerSize bytes, stride apart from the request address,
+    // then size bytes at every non-null pointer + offset. The response is count u64 pointers, count u8
+    // valid flags (1 when the block could be read), then count blocks of size bytes, zeroed when not valid.
+    // A pointer array that can't be read fails the whole request.
+    struct gatherRequest {
+        uint32_t count;
+        uint32_t stride;
+        int32_t offset;
+        uint32_t size;
+        uint8_t pointerSize;
+        uint8_t reserved[3];
+    };
+#pragma pack(pop)
+
+    // What the other end of this session can do, filled from its hello. Each side only uses what both support.
+    struct capabilities {
+        uint32_t version = 1;
+        uint32_t opMask = 0;            // bit n set when frameOp n is understood
+        bool binary = false;            // binary frames at all
+        bool batch = false;             // batch envelopes and several frames per binary message
+        bool compression = false;
+        bool subscriptions = false;
+        uint32_t maxFrame = 1024 * 1024;  // largest single frame the peer accepts or sends, header included
+        uint32_t pointerSize = 8;
+        uint32_t window = 0;            // requests the peer wants in flight at most, 0 = no preference
+
+        bool hasOp(uint8_t op) const {
+            return binary && op < 32 && (opMask & (1u << op));
+        }
+
+        // Payload bytes that fit in one frame
+        uint32_t maxPayload() const {
+            return maxFrame > sizeof(frameHeader) ? maxFrame - static_cast<uint32_t>(sizeof(frameHeader)) : 0;
+        }
+    };
+
+    // Text batch envelope: this header line, then one JSON message per line. JSON never contains a raw
+    // newline, so splitting on '\n' is enough. The bridge adds a count field, nothing relies on it.
+    inline constexpr std::string_view batchHeader = "{\"type\":\"batch\"}";
+    inline constexpr std::string_view batchPrefix = "{\"type\":\"batch\"";
+
+    static_assert(sizeof(frameHeader) == 20, "frameHeader must match the bridge layout");
+    static_assert(sizeof(batchRange) == 12, "batchRange must match the bridge layout");
+    static_assert(sizeof(subscribeRequest) == 12, "subscribeRequest must match the bridge layout");
+    static_assert(sizeof(deltaRun) == 8, "deltaRun must match the bridge layout");
+    static_assert(sizeof(chainRequest) == 8, "chainRequest must match the bridge layout");
+    static_assert(sizeof(chainReply) == 8, "chainReply must match the bridge layout");
+    static_assert(sizeof(gatherRequest) == 20, "gatherRequest must match the bridge layout");
+
+    inline const char* opName(uint8_t op) {
+        switch (op) {
+        case op_rvm: return "rvm";
+        case op_wvm: return "wvm";
+        case op_rvm_batch: return "rvm_batch";
+        case op_subscribe: return "subscribe";
+        case op_unsubscribe: return "unsubscribe";
+        case op_push: return "push";
+        case op_resync: return "resync";
+        case op_deref_chain: return "deref_chain";
+        case op_gather: return "gather";
+        default: return "unknown";
+        }
+    }
+
+    inline uint8_t opFromName(std::string_view name) {
+        for (uint8_t op : knownOps) {
+            if (name == opName(op)) {
+                return op;
+            }
+        }
+        return 0;
+    }
+
+    // Ops that only read, safe to send again when the link dropped before their answer came
+    inline bool isReplayable(uint8_t op) {
+        return op == op_rvm || op == op_rvm_batch || op == op_deref_chain || op == op_gather;
+    }
+
+    // Everything this build understands, advertised in the hello_ack
+    inline std::string supportedOps() {
+        std::string list;
+        for (uint8_t op : knownOps) {
+            list += (list.empty() ? "" : ",") + std::string(opName(op));
+        }
+        return list;
+    }
+
+    inline void forEachToken(std::string_view list, const auto& visit) {
+        while (!list.empty()) {
+            size_t comma = list.find(',');
+            std::string_view token = list.substr(0, comma);
+            if (!token.empty()) {
+                visit(token);
+            }
+            if (comma == std::string_view::npos) {
+                break;
+            }
+            list.remove_prefix(comma + 1);
+        }
+    }
+
+    // Comma separated op names, e.g. "rvm,wvm,rvm_batch"
+    inline uint32_t parseOps(std::string_view list) {
+        uint32_t mask = 0;
+        forEachToken(list, [&](std::string_view token) {
+            uint8_t op = opFromName(token);
+            if (op) {
+                mask |= 1u << op;
+            }
+            });
+        return mask;
+    }
+
+    inline uint32_t parseNumber(std::string_view text, uint32_t fallback) {
+        uint32_t value = 0;
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return (result.ec == std::errc() && value) ? value : fallback;
+    }
+
+    inline std::vector<uint8_t> buildFrame(uint8_t op, uint32_t requestId, uint64_t address, uint32_t length,
+        const void* payload = nullptr, size_t payloadSize = 0) {
+        frameHeader header{};
+        header.op = op;
+        header.requestId = requestId;
+        header.address = address;
+        header.length = length;
+
+        std::vector<uint8_t> frame(sizeof(frameHeader) + payloadSize);
+        memcpy(frame.data(), &header, sizeof(frameHeader));
+        if (payload && payloadSize) {
+            memcpy(frame.data() + sizeof(frameHeader), payload, payloadSize);
+        }
+        return frame;
+    }
+
+    // XORs a delta into base in place. False on a malformed delta, base may be partly updated then and
+    // needs a resync.
+    inline bool applyDelta(uint8_t* base, size_t size, const uint8_t* delta, size_t length) {
+        size_t position = 0;
+        size_t offset = 0;
+        while (offset < length) {
+            deltaRun run;
+            if (length - offset < sizeof(run)) {
+                return false;
+            }
+            memcpy(&run, delta + offset, sizeof(run));
+            offset += sizeof(run);
+
+            if (run.count > length - offset || run.skip > size - position || run.count > size - position - run.skip) {
+                return false;
+            }
+
+            position += run.skip;
+            for (uint32_t i = 0; i < run.count; i++) {
+                base[position + i] ^= delta[offset + i];
+            }
+            position += run.count;
+            offset += run.count;
+        }
+        return true;
+    }
+
+    // Size of a complete frame, a binary message may carry several back to back
+    inline size_t frameSize(const frameHeader& header) {
+        bool hasPayload = header.op != op_rvm || (header.flags & flag_response);
+        return sizeof(frameHeader) + (hasPayload ? header.length : 0);
+    }
+
+    // Validates the header against the received size, payload points into data
+    inline bool parseFrame(const uint8_t* data, size_t size, frameHeader& header, const uint8_t*& payload) {
+        if (size < sizeof(frameHeader)) {
+            return false;
+        }
+
+        memcpy(&header, data, sizeof(frameHeader));
+        payload = data + sizeof(frameHeader);
+
+        // rvm requests carry no payload, everything else must fit in the message
+        bool hasPayload = header.op != op_rvm || (header.flags & flag_response);
+        return !hasPayload || header.length <= size - sizeof(frameHeader);
+    }
+}
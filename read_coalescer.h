@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "request_table.h"
+
+// In-flight read table sitting in front of the bridge. A read covered by a span that's already
+// outstanding attaches to it instead of going out again, as long as that span is at least as urgent
+// and won't be dropped before the read's own deadline; small reads close to each other that arrive
+// within the merge window go out as one span. Every waiter gets a view of its own bytes
+// once the span's reply is in.
+class ReadCoalescer {
+public:
+    using Callback = std::function<void(bool, const uint8_t*, size_t)>;
+
+    // gaps up to this many bytes between two reads are read along rather than split
+    static constexpr uintptr_t MERGE_GAP = 256;
+    // merging stops once a span reaches this size
+    static constexpr uintptr_t MERGE_LIMIT = 64 * 1024;
+
+    struct Stats {
+        uint64_t requested = 0;     // reads handed in
+        uint64_t attached = 0;      // served by a span that was already outstanding
+        uint64_t merged = 0;        // folded into a neighbouring pending span
+        uint64_t sent = 0;          // spans that went out
+        uint64_t bytesRequested = 0;
+        uint64_t bytesSent = 0;
+    };
+
+private:
+    struct Waiter {
+        uintptr_t address;
+        uintptr_t size;
+        Callback callback;
+    };
+
+    struct Span {
+        uintptr_t address;
+        uintptr_t size;
+        requestPriority priority;
+        std::chrono::milliseconds deadline;
+        std::chrono::steady_clock::time_point sent;     // set once it goes out
+        std::vector<Waiter> waiters;
+    };
+
+    struct State {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Span>> pending;
+        std::vector<std::shared_ptr<Span>> inFlight;
+        bool flushScheduled = false;
+        Stats stats;
+    };
+
+    static bool covers(const Span& span, uintptr_t address, uintptr_t size) {
+        return span.address <= address && address + size <= span.address + span.size;
+    }
+
+    // An outstanding span can't be promoted anymore, a read only rides along if the span is queued at
+    // least as urgently and stays alive at least as long (no deadline outlives any)
+    static bool serves(const Span& span, requestPriority priority, std::chrono::milliseconds deadline,
+        std::chrono::steady_clock::time_point now) {
+        if (span.priority > priority) {
+            return false;
+        }
+        if (!span.deadline.count()) {
+            return true;
+        }
+        return deadline.count() && span.sent + span.deadline >= now + deadline;
+    }
+
+    static void deliver(std::vector<Waiter>& waiters, uintptr_t base, bool success, const uint8_t* bytes, size_t length) {
+        for (auto& waiter : waiters) {
+            size_t offset = waiter.address - base;
+            if (success && offset + waiter.size <= length) {
+                waiter.callback(true, bytes + offset, waiter.size);
+            }
+            else {
+                waiter.callback(false, nullptr, 0);
+            }
+        }
+    }
+
+public:
+    // Handed to whoever sends a span. complete() hands the reply to every waiter; a Completion
+    // destroyed without it (request dropped, timed out, link gone) fails them instead.
+    class Completion {
+    private:
+        std::weak_ptr<State> state;
+        std::shared_ptr<Span> span;
+        bool done = false;
+
+    public:
+        Completion(std::weak_ptr<State> owner, std::shared_ptr<Span> sent)
+            : state(std::move(owner)), span(std::move(sent))
+        {
+        }
+
+        Completion(const Completion&) = delete;
+        Completion& operator=(const Completion&) = delete;
+
+        ~Completion() {
+            if (!done) {
+                complete(false, nullptr, 0);
+            }
+        }
+
+        void complete(bool success, const uint8_t* bytes, size_t length) {
+            done = true;
+
+            // once it's out of the table nobody else can attach, the waiters are ours
+            if (auto owner = state.lock()) {
+                std::lock_guard<std::mutex> lock(owner->mutex);
+                auto& inFlight = owner->inFlight;
+                inFlight.erase(std::remove(inFlight.begin(), inFlight.end(), span), inFlight.end());
+            }
+
+            deliver(span->waiters, span->address, success, bytes, length);
+            span->waiters.clear();
+        }
+    };
+
+    struct Read {
+        uintptr_t address;
+        uintptr_t size;
+        requestPriority priority;
+        std::chrono::milliseconds deadline;
+        std::shared_ptr<Completion> completion;
+    };
+
+    // issue sends a set of spans, defer runs a task after the merge window
+    using Issue = std::function<void(std::vector<Read>)>;
+    using Defer = std::function<void(std::function<void()>)>;
+
+private:
+    std::shared_ptr<State> state = std::make_shared<State>();
+    Issue issue;
+    Defer defer;
+
+public:
+    ReadCoalescer(Issue issueReads, Defer deferFlush)
+        : issue(std::move(issueReads)), defer(std::move(deferFlush))
+    {
+    }
+
+    // Queues a read, it goes out with the next flush. The callback runs on whatever thread
+    // completes the span and the view is only valid for the duration of the call.
+    void read(uintptr_t address, uintptr_t size, requestPriority priority, std::chrono::milliseconds deadline, Callback callback) {
+        bool scheduleFlush = false;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->stats.requested++;
+            state->stats.bytesRequested += size;
+
+            auto now = std::chrono::steady_clock::now();
+            for (auto& span : state->inFlight) {
+                if (covers(*span, address, size) && serves(*span, priority, deadline, now)) {
+                    span->waiters.push_back({ address, size, std::move(callback) });
+                    state->stats.attached++;
+                    return;
+                }
+            }
+
+            std::shared_ptr<Span> target;
+            for (auto& span : state->pending) {
+                if (covers(*span, address, size)) {
+                    target = span;
+                    state->stats.attached++;
+                    break;
+                }
+
+                uintptr_t start = (std::min)(span->address, address);
+                uintptr_t end = (std::max)(span->address + span->size, address + size);
+                bool close = address <= span->address + span->size + MERGE_GAP && span->address <= address + size + MERGE_GAP;
+                if (close && end - start <= MERGE_LIMIT) {
+                    span->address = start;
+                    span->size = end - start;
+                    target = span;
+                    state->stats.merged++;
+                    break;
+                }
+            }
+
+            if (target) {
+                // the span goes out as urgent as its most urgent waiter, and stays until the latest deadline
+                target->priority = (std::min)(target->priority, priority);
+                if (!target->deadline.count() || !deadline.count()) {
+                    target->deadline = {};
+                }
+                else {
+                    target->deadline = (std::max)(target->deadline, deadline);
+                }
+                target->waiters.push_back({ address, size, std::move(callback) });
+            }
+            else {
+                auto span = std::make_shared<Span>();
+                span->address = address;
+                span->size = size;
+                span->priority = priority;
+                span->deadline = deadline;
+                span->waiters.push_back({ address, size, std::move(callback) });
+                state->pending.push_back(std::move(span));
+            }
+
+            if (!state->flushScheduled) {
+                state->flushScheduled = true;
+                scheduleFlush = true;
+            }
+        }
+
+        if (scheduleFlush) {
+            defer([this]() { flush(); });
+        }
+    }
+
+    // Sends everything pending right away, for callers that know their burst is complete
+    void flush() {
+        std::vector<Read> reads;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->flushScheduled = false;
+            if (state->pending.empty()) {
+                return;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            for (auto& span : state->pending) {
+                span->sent = now;
+                state->stats.sent++;
+                state->stats.bytesSent += span->size;
+                reads.push_back({ span->address, span->size, span->priority, span->deadline,
+                    std::make_shared<Completion>(state, span) });
+                state->inFlight.push_back(std::move(span));
+            }
+            state->pending.clear();
+        }
+
+        issue(std::move(reads));
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->stats;
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stats = {};
+    }
+};
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "request_table.h"
+
+// Decides which regions the memory thread reads on a pass. Every region remembers a hash of what it
+// held last time: one that changed is read again at the fastest interval, one that didn't waits twice
+// as long as before, up to MAX_INTERVAL or the region's own limit. A region can pin its own interval
+// instead. Whatever is due also has to fit a global budget of bytes and requests per second, so a pile
+// of open classes can't swamp the bridge; what doesn't fit stays due for the next pass, most overdue
+// first.
+class RefreshScheduler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // the slowest a region that never changes is read
+    static constexpr std::chrono::milliseconds MAX_INTERVAL{ 2000 };
+    static constexpr uint64_t DEFAULT_BYTES_PER_SECOND = 16 * 1024 * 1024;
+    static constexpr uint64_t DEFAULT_REQUESTS_PER_SECOND = 1000;
+
+    struct Region {
+        uintptr_t address;
+        uintptr_t size;
+        requestPriority priority;
+        std::chrono::milliseconds pinned{};     // fixed interval, zero to adapt
+        std::chrono::milliseconds slowest{};    // how far an adapting region may back off, zero for MAX_INTERVAL
+    };
+
+    struct Stats {
+        size_t regions = 0;
+        size_t hot = 0;             // regions at the fastest interval
+        uint64_t scheduled = 0;
+        uint64_t changed = 0;
+        uint64_t unchanged = 0;
+        uint64_t overBudget = 0;    // due regions pushed to a later pass by the budget
+        uint64_t bytesPerSecond = 0;
+        uint64_t requestsPerSecond = 0;
+    };
+
+private:
+    struct State {
+        std::chrono::milliseconds interval;
+        std::chrono::milliseconds slowest;
+        clock::time_point due;
+        uint64_t hash = 0;
+        bool known = false;     // hash holds a previous read
+        bool pinned = false;
+        bool seen = false;      // still wanted this pass
+    };
+
+    using Key = std::pair<uintptr_t, uintptr_t>;
+
+    std::mutex mutex;
+    std::map<Key, State> regions;
+    std::chrono::milliseconds minInterval;
+
+    // token buckets, allowed to go negative so a region bigger than a second's worth still gets read
+    uint64_t bytesPerSecond = DEFAULT_BYTES_PER_SECOND;
+    uint64_t requestsPerSecond = DEFAULT_REQUESTS_PER_SECOND;
+    double byteTokens = DEFAULT_BYTES_PER_SECOND;
+    double requestTokens = DEFAULT_REQUESTS_PER_SECOND;
+    clock::time_point refilled = clock::now();
+
+    Stats counters;
+
+    static uint64_t hashBytes(const uint8_t* data, size_t size) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ data[i]) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static void refill(double& tokens, uint64_t rate, double seconds) {
+        if (!rate) {
+            return;
+        }
+        tokens = (std::min)(tokens + rate * seconds, static_cast<double>(rate));
+    }
+
+public:
+    explicit RefreshScheduler(std::chrono::milliseconds fastest)
+        : minInterval(fastest)
+    {
+    }
+
+    // Takes every region that should stay fresh and returns the ones to read now. Regions no longer
+    // passed in are forgotten.
+    std::vector<Region> schedule(const std::vector<Region>& wanted, clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        double seconds = std::chrono::duration<double>(now - refilled).count();
+        refilled = now;
+        refill(byteTokens, bytesPerSecond, seconds);
+        refill(requestTokens, requestsPerSecond, seconds);
+
+        struct Due {
+            const Region* region;
+            State* state;
+        };
+        std::vector<Due> due;
+
+        for (auto& region : wanted) {
+            auto [it, inserted] = regions.try_emplace(Key{ region.address, region.size });
+            State& state = it->second;
+            if (inserted) {
+                // nothing known about it yet, read it right away
+                state.interval = minInterval;
+                state.due = now;
+            }
+            state.slowest = region.slowest.count() ? region.slowest : MAX_INTERVAL;
+            state.interval = (std::min)(state.interval, state.slowest);
+            state.due = (std::min)(state.due, now + state.slowest);
+            state.pinned = region.pinned.count() != 0;
+            if (state.pinned) {
+                state.interval = region.pinned;
+                state.due = (std::min)(state.due, now + region.pinned);
+            }
+            // the same region wanted twice is still read once
+            bool first = !state.seen;
+            state.seen = true;
+
+            if (first && state.due <= now) {
+                due.push_back({ &region, &state });
+            }
+        }
+
+        for (auto it = regions.begin(); it != regions.end();) {
+            if (!it->second.seen) {
+                it = regions.erase(it);
+                continue;
+            }
+            it->second.seen = false;
+            ++it;
+        }
+
+        std::sort(due.begin(), due.end(), [](const Due& a, const Due& b) {
+            if (a.region->priority != b.region->priority) {
+                return a.region->priority < b.region->priority;
+            }
+            return a.state->due < b.state->due;
+        });
+
+        std::vector<Region> result;
+        for (auto& entry : due) {
+            if ((bytesPerSecond && byteTokens <= 0) || (requestsPerSecond && requestTokens <= 0)) {
+                counters.overBudget++;
+                continue;
+            }
+
+            byteTokens -= static_cast<double>(entry.region->size);
+            requestTokens -= 1;
+            entry.state->due = now + entry.state->interval;
+            counters.scheduled++;
+            result.push_back(*entry.region);
+        }
+        return result;
+    }
+
+    // Feeds a finished read back, a change brings the region back to the fastest interval
+    void report(uintptr_t address, uintptr_t size, const uint8_t* data, size_t length, clock::time_point now) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = regions.find(Key{ address, size });
+        if (it == regions.end()) {
+            return;
+        }
+
+        State& state = it->second;
+        uint64_t hash = hashBytes(data, length);
+        bool changed = !state.known || hash != state.hash;
+        state.hash = hash;
+        state.known = true;
+
+        if (changed) {
+            counters.changed++;
+        }
+        else {
+            counters.unchanged++;
+        }
+
+        if (state.pinned) {
+            return;
+        }
+
+        state.interval = changed ? minInterval : (std::min)(state.interval * 2, state.slowest);
+        state.due = now + state.interval;
+    }
+
+    // Zero turns a limit off
+    void setBudget(uint64_t bytes, uint64_t requests) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bytesPerSecond = bytes;
+        requestsPerSecond = requests;
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats result = counters;
+        result.regions = regions.size();
+        for (auto& [key, state] : regions) {
+            result.hot += state.interval <= minInterval;
+        }
+        result.bytesPerSecond = bytesPerSecond;
+        result.requestsPerSecond = requestsPerSecond;
+        return result;
+    }
+
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters = {};
+    }
+};
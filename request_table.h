@@ -0,0 +1,222 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Dispatch order for bridge requests, lower values are served first
+enum requestPriority : uint8_t {
+    priority_interactive = 0,   // visible classes, reads and writes the user is waiting on
+    priority_preview = 1,       // pointer preview tooltips
+    priority_normal = 2,        // attach, module list, RTTI
+    priority_background = 3,    // export harvesting, pattern scan chunks
+    priority_count
+};
+
+// Fixed pool of pending bridge requests. A request ID is (generation << SLOT_BITS) | slot, so a reply
+// only has to index the slot array and compare generations - a late reply for a slot that timed out
+// and got reused carries the old generation and is rejected. Timeouts live in a hashed timer wheel,
+// expiring requests costs O(expired) instead of a walk over everything in flight.
+// All operations are O(1) under a short lock and never allocate after construction.
+class RequestTable {
+public:
+    static constexpr uint32_t SLOT_BITS = 12;
+    static constexpr uint32_t SLOT_COUNT = 1u << SLOT_BITS;
+    static constexpr uint32_t SLOT_MASK = SLOT_COUNT - 1;
+
+    static constexpr uint32_t WHEEL_SIZE = 64;
+    static constexpr std::chrono::milliseconds TICK{ 100 };
+
+    struct Request {
+        uint32_t id = 0;
+        std::string type;
+        std::chrono::steady_clock::time_point timestamp;
+        std::function<void(std::string_view)> callback;
+        std::function<void(bool, const uint8_t*, size_t)> binary_callback;
+    };
+
+private:
+    static constexpr int32_t NONE = -1;
+
+    struct Slot {
+        Request request;
+        uint32_t generation = 0;
+        bool active = false;
+        bool armed = false;
+        uint64_t deadlineTick = 0;
+        int32_t prev = NONE;
+        int32_t next = NONE;
+    };
+
+    std::mutex mutex;
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    int32_t wheel[WHEEL_SIZE];
+    uint64_t currentTick;
+    std::chrono::steady_clock::time_point epoch;
+
+    uint64_t tickOf(std::chrono::steady_clock::time_point time) const {
+        return static_cast<uint64_t>((time - epoch) / TICK);
+    }
+
+    void link(uint32_t index) {
+        Slot& slot = slots[index];
+        int32_t& head = wheel[slot.deadlineTick % WHEEL_SIZE];
+        slot.prev = NONE;
+        slot.next = head;
+        if (head != NONE) {
+            slots[head].prev = static_cast<int32_t>(index);
+        }
+        head = static_cast<int32_t>(index);
+    }
+
+    void unlink(uint32_t index) {
+        Slot& slot = slots[index];
+        if (slot.prev != NONE) {
+            slots[slot.prev].next = slot.next;
+        }
+        else {
+            wheel[slot.deadlineTick % WHEEL_SIZE] = slot.next;
+        }
+        if (slot.next != NONE) {
+            slots[slot.next].prev = slot.prev;
+        }
+        slot.prev = slot.next = NONE;
+    }
+
+    void schedule(uint32_t index, std::chrono::steady_clock::time_point start, std::chrono::milliseconds timeout) {
+        Slot& slot = slots[index];
+        // always at least one full tick out so a request can't expire the moment it's armed
+        uint64_t deadline = tickOf(start + timeout) + 1;
+        slot.deadlineTick = (deadline > currentTick) ? deadline : currentTick + 1;
+        slot.armed = true;
+        link(index);
+    }
+
+    Request release(uint32_t index) {
+        Slot& slot = slots[index];
+        if (slot.armed) {
+            unlink(index);
+        }
+        slot.active = false;
+        slot.armed = false;
+        freeSlots.push_back(index);
+        return std::move(slot.request);
+    }
+
+public:
+    RequestTable()
+        : slots(SLOT_COUNT), currentTick(0), epoch(std::chrono::steady_clock::now())
+    {
+        freeSlots.reserve(SLOT_COUNT);
+        for (uint32_t i = SLOT_COUNT; i > 0; i--) {
+            freeSlots.push_back(i - 1);
+        }
+        for (auto& head : wheel) {
+            head = NONE;
+        }
+    }
+
+    // Returns the request ID, or 0 if every slot is in use. An unarmed request holds its slot but
+    // doesn't start timing out until arm() - used for requests waiting on flow control credit.
+    uint32_t add(Request request, std::chrono::milliseconds timeout, bool armed = true) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (freeSlots.empty()) {
+            return 0;
+        }
+
+        uint32_t index = freeSlots.back();
+        freeSlots.pop_back();
+
+        Slot& slot = slots[index];
+        // generation 0 is skipped so no valid ID is ever 0
+        slot.generation = ((slot.generation + 1) & (UINT32_MAX >> SLOT_BITS)) ? slot.generation + 1 : 1;
+        slot.active = true;
+        slot.request = std::move(request);
+        slot.request.id = (slot.generation << SLOT_BITS) | index;
+
+        if (armed) {
+            schedule(index, slot.request.timestamp, timeout);
+        }
+
+        return slot.request.id;
+    }
+
+    // Starts the timeout of a request added unarmed, counted from now
+    bool arm(uint32_t id, std::chrono::milliseconds timeout) {
+        uint32_t index = id & SLOT_MASK;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot& slot = slots[index];
+        if (!slot.active || slot.request.id != id || slot.armed) {
+            return false;
+        }
+
+        schedule(index, std::chrono::steady_clock::now(), timeout);
+        return true;
+    }
+
+    // Stops the timeout of an armed request, for one that went back to waiting on credit
+    bool disarm(uint32_t id) {
+        uint32_t index = id & SLOT_MASK;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot& slot = slots[index];
+        if (!slot.active || slot.request.id != id || !slot.armed) {
+            return false;
+        }
+
+        unlink(index);
+        slot.armed = false;
+        return true;
+    }
+
+    // Removes the request matching the ID, false for unknown or stale IDs
+    bool take(uint32_t id, Request& out) {
+        uint32_t index = id & SLOT_MASK;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot& slot = slots[index];
+        if (!slot.active || slot.request.id != id) {
+            return false;
+        }
+
+        out = release(index);
+        return true;
+    }
+
+    // Advances the wheel to now and hands back everything that timed out
+    void expire(std::chrono::steady_clock::time_point now, std::vector<Request>& expired) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        uint64_t target = tickOf(now);
+        if (target <= currentTick) {
+            return;
+        }
+
+        // after a long stall every bucket gets visited once, that covers every deadline in the past
+        uint64_t first = (target - currentTick > WHEEL_SIZE) ? target - WHEEL_SIZE + 1 : currentTick + 1;
+
+        for (uint64_t tick = first; tick <= target; tick++) {
+            int32_t index = wheel[tick % WHEEL_SIZE];
+            while (index != NONE) {
+                int32_t next = slots[index].next;
+                if (slots[index].deadlineTick <= target) {
+                    expired.push_back(release(static_cast<uint32_t>(index)));
+                }
+                index = next;
+            }
+        }
+
+        currentTick = target;
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return SLOT_COUNT - freeSlots.size();
+    }
+};
@@ -0,0 +1,531 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+// Same-machine alternative to the WebSocket link: one named mapping holding two single-producer
+// single-consumer rings, requests (ImClass -> bridge) and responses (bridge -> ImClass).
+// A message is a record header plus its bytes stored contiguously in the ring, so sending costs one
+// memcpy and the reader hands out a view straight into the mapping. Doorbells are a sequence word in the
+// mapping, paired with a named auto-reset event on Windows and a shared futex on Linux (other POSIX
+// systems fall back to short sleeps).
+// Platform-neutral on purpose (no asio, no logging), a stand-in bridge and tests/shm_echo.cpp build it
+// on Linux as is; ShmTransport in shm_transport.h adapts it to the Transport interface.
+namespace shm {
+    constexpr uint32_t MAGIC = 0x53434D49;  // "IMCS"
+    constexpr uint32_t VERSION = 1;
+
+    enum recordKind : uint32_t {
+        record_pad = 0,     // filler up to the end of the ring, the reader skips to offset 0
+        record_text = 1,    // JSON message
+        record_binary = 2,  // one or more protocol frames
+    };
+
+    struct recordHeader {
+        uint32_t size;
+        uint32_t kind;
+    };
+
+    enum writeResult : uint8_t {
+        write_ok,
+        write_full,     // no room right now, try again once the consumer caught up
+        write_failed,   // too big for the ring or not attached, retrying won't help
+    };
+
+    struct alignas(64) controlBlock {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t ringCapacity;
+        std::atomic<uint32_t> serverAttached;
+        std::atomic<uint32_t> clientAttached;
+    };
+
+    struct ringHeader {
+        alignas(64) std::atomic<uint64_t> head;     // advanced by the consumer
+        alignas(64) std::atomic<uint64_t> tail;     // advanced by the producer
+        alignas(64) std::atomic<uint32_t> dataBell;
+        std::atomic<uint32_t> spaceBell;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring positions must be lock-free to live in shared memory");
+
+    inline uint64_t align8(uint64_t value) {
+        return (value + 7) & ~uint64_t(7);
+    }
+
+    class Doorbell {
+    private:
+        std::atomic<uint32_t>* word = nullptr;
+#ifdef _WIN32
+        HANDLE event = nullptr;
+#endif
+
+    public:
+        Doorbell() = default;
+        Doorbell(const Doorbell&) = delete;
+        Doorbell& operator=(const Doorbell&) = delete;
+
+        ~Doorbell() {
+            close();
+        }
+
+        bool open(std::atomic<uint32_t>* sharedWord, const std::string& name) {
+            word = sharedWord;
+#ifdef _WIN32
+            event = CreateEventA(nullptr, FALSE, FALSE, ("Local\\" + name).c_str());
+            return event != nullptr;
+#else
+            (void)name;
+            return true;
+#endif
+        }
+
+        void close() {
+#ifdef _WIN32
+            if (event) {
+                CloseHandle(event);
+                event = nullptr;
+            }
+#endif
+            word = nullptr;
+        }
+
+        uint32_t sequence() const {
+            return word->load(std::memory_order_acquire);
+        }
+
+        void ring() {
+            word->fetch_add(1, std::memory_order_release);
+#ifdef _WIN32
+            SetEvent(event);
+#elif defined(__linux__)
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+        }
+
+        // Returns once the sequence moved past seen or the timeout ran out, spurious wakeups are possible
+        void wait(uint32_t seen, std::chrono::milliseconds timeout) {
+            if (sequence() != seen) {
+                return;
+            }
+#ifdef _WIN32
+            WaitForSingleObject(event, static_cast<DWORD>(timeout.count()));
+#elif defined(__linux__)
+            timespec ts{};
+            ts.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+            ts.tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000);
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, seen, &ts, nullptr, 0);
+#else
+            std::this_thread::sleep_for((std::min)(timeout, std::chrono::milliseconds(1)));
+#endif
+        }
+    };
+
+    class Ring {
+    private:
+        ringHeader* header = nullptr;
+        uint8_t* data = nullptr;
+        uint64_t capacity = 0;
+        Doorbell dataBell;
+        Doorbell spaceBell;
+        // the peer wrote a record that doesn't fit what's in the ring, nothing after it can be trusted
+        bool corrupt = false;
+
+        void put(uint64_t position, uint32_t kind, const void* bytes, size_t size) {
+            recordHeader record{ static_cast<uint32_t>(size), kind };
+            uint8_t* out = data + (position % capacity);
+            memcpy(out, &record, sizeof(record));
+            if (size) {
+                memcpy(out + sizeof(record), bytes, size);
+            }
+        }
+
+    public:
+        bool attach(ringHeader* ringHeaderPtr, uint8_t* ringData, uint64_t ringCapacity, const std::string& name) {
+            header = ringHeaderPtr;
+            data = ringData;
+            capacity = ringCapacity;
+            corrupt = false;
+            return dataBell.open(&header->dataBell, name + "_data") && spaceBell.open(&header->spaceBell, name + "_space");
+        }
+
+        void detach() {
+            dataBell.close();
+            spaceBell.close();
+            header = nullptr;
+            data = nullptr;
+        }
+
+        // Largest message that can ever fit, half the ring so a wrap never deadlocks
+        size_t maxMessage() const {
+            return static_cast<size_t>(capacity / 2 - sizeof(recordHeader));
+        }
+
+        // Producer side. Never waits, a full ring is write_full and the caller retries later (see
+        // spaceSequence/waitForSpace for producers that can afford to block).
+        writeResult write(uint32_t kind, const void* bytes, size_t size) {
+            if (!header || size > maxMessage()) {
+                return write_failed;
+            }
+
+            uint64_t need = align8(sizeof(recordHeader) + size);
+            uint64_t tail = header->tail.load(std::memory_order_relaxed);
+            uint64_t head = header->head.load(std::memory_order_acquire);
+
+            uint64_t contiguous = capacity - (tail % capacity);
+            uint64_t pad = (contiguous < need) ? contiguous : 0;
+
+            if (tail + pad + need - head > capacity) {
+                return write_full;
+            }
+
+            if (pad) {
+                put(tail, record_pad, nullptr, 0);
+                tail += pad;
+            }
+            put(tail, kind, bytes, size);
+            header->tail.store(tail + need, std::memory_order_release);
+            dataBell.ring();
+            return write_ok;
+        }
+
+        uint32_t spaceSequence() const {
+            return spaceBell.sequence();
+        }
+
+        void waitForSpace(uint32_t seen, std::chrono::milliseconds timeout) {
+            spaceBell.wait(seen, timeout);
+        }
+
+        // Consumer side. handler(kind, bytes, size) sees a view into the ring that is only valid during the call.
+        // Stops at the first record whose header doesn't add up (size past what was written or across the
+        // wrap, unknown kind) and marks the ring corrupt, see isCorrupt.
+        template<typename Handler>
+        size_t read(Handler&& handler) {
+            if (!header || corrupt) {
+                return 0;
+            }
+
+            uint64_t head = header->head.load(std::memory_order_relaxed);
+            uint64_t tail = header->tail.load(std::memory_order_acquire);
+            size_t count = 0;
+
+            while (head != tail) {
+                // tail (and head, it's in the mapping too) can be written by the peer as much as the records
+                // can, an aligned offset keeps the header itself inside the ring
+                uint64_t available = tail - head;
+                uint64_t offset = head % capacity;
+                if (available > capacity || available < sizeof(recordHeader) || (offset & 7)) {
+                    corrupt = true;
+                    break;
+                }
+
+                recordHeader record;
+                const uint8_t* in = data + offset;
+                memcpy(&record, in, sizeof(record));
+
+                if (record.kind == record_pad) {
+                    if (capacity - offset > available) {
+                        corrupt = true;
+                        break;
+                    }
+                    head += capacity - offset;
+                    continue;
+                }
+
+                uint64_t length = sizeof(recordHeader) + uint64_t(record.size);
+                if ((record.kind != record_text && record.kind != record_binary) ||
+                    length > capacity - offset || align8(length) > available) {
+                    corrupt = true;
+                    break;
+                }
+
+                handler(record.kind, in + sizeof(record), static_cast<size_t>(record.size));
+                head += align8(sizeof(recordHeader) + record.size);
+                count++;
+            }
+
+            if (count || head != header->head.load(std::memory_order_relaxed)) {
+                header->head.store(head, std::memory_order_release);
+                spaceBell.ring();
+            }
+            return count;
+        }
+
+        bool isCorrupt() const {
+            return corrupt;
+        }
+
+        uint32_t sequence() const {
+            return dataBell.sequence();
+        }
+
+        void wait(uint32_t seen, std::chrono::milliseconds timeout) {
+            dataBell.wait(seen, timeout);
+        }
+
+        void wake() {
+            dataBell.ring();
+        }
+    };
+
+    // Either end of the shared-memory link. ImClass create()s it, the bridge open()s it; the request ring
+    // is written by the creator and the response ring by the opener.
+    class Link {
+    public:
+        static constexpr uint64_t DEFAULT_RING_CAPACITY = 8 * 1024 * 1024;
+
+    private:
+        std::string name;
+        bool owner = false;
+        size_t mappingSize = 0;
+        void* view = nullptr;
+#ifdef _WIN32
+        HANDLE mapping = nullptr;
+#endif
+
+        controlBlock* control = nullptr;
+        Ring requests;
+        Ring responses;
+
+        static size_t layoutSize(uint64_t capacity) {
+            return sizeof(controlBlock) + 2 * (sizeof(ringHeader) + capacity);
+        }
+
+        bool map(size_t size, bool create) {
+#ifdef _WIN32
+            std::string mappingName = "Local\\" + name;
+            if (create) {
+                mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                    static_cast<DWORD>(uint64_t(size) >> 32), static_cast<DWORD>(size), mappingName.c_str());
+            }
+            else {
+                mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, mappingName.c_str());
+            }
+            if (!mapping) {
+                return false;
+            }
+
+            view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+            return view != nullptr;
+#else
+            std::string shmName = "/" + name;
+            int fd = create ? shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0600) : shm_open(shmName.c_str(), O_RDWR, 0);
+            if (fd < 0) {
+                return false;
+            }
+            if (create && ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                ::close(fd);
+                return false;
+            }
+
+            void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            view = (address == MAP_FAILED) ? nullptr : address;
+            return view != nullptr;
+#endif
+        }
+
+        void unmap() {
+#ifdef _WIN32
+            if (view) {
+                UnmapViewOfFile(view);
+            }
+            if (mapping) {
+                CloseHandle(mapping);
+                mapping = nullptr;
+            }
+#else
+            if (view) {
+                munmap(view, mappingSize);
+            }
+            if (owner) {
+                shm_unlink(("/" + name).c_str());
+            }
+#endif
+            view = nullptr;
+        }
+
+        bool attachRings() {
+            uint64_t capacity = control->ringCapacity;
+            auto base = static_cast<uint8_t*>(view) + sizeof(controlBlock);
+            auto requestHeader = reinterpret_cast<ringHeader*>(base);
+            auto responseHeader = reinterpret_cast<ringHeader*>(base + sizeof(ringHeader) + capacity);
+
+            return requests.attach(requestHeader, base + sizeof(ringHeader), capacity, name + "_req") &&
+                responses.attach(responseHeader, reinterpret_cast<uint8_t*>(responseHeader) + sizeof(ringHeader), capacity, name + "_resp");
+        }
+
+        Ring& outgoing() { return owner ? requests : responses; }
+        Ring& incoming() { return owner ? responses : requests; }
+
+    public:
+        Link() = default;
+        Link(const Link&) = delete;
+        Link& operator=(const Link&) = delete;
+
+        ~Link() {
+            close();
+        }
+
+        // ringCapacity must be a power of two
+        bool create(const std::string& mappingName, uint64_t ringCapacity = DEFAULT_RING_CAPACITY) {
+            if ((ringCapacity & (ringCapacity - 1)) || ringCapacity < 4096) {
+                return false;
+            }
+
+            name = mappingName;
+            owner = true;
+            mappingSize = layoutSize(ringCapacity);
+            if (!map(mappingSize, true)) {
+                close();
+                return false;
+            }
+
+            auto base = static_cast<uint8_t*>(view);
+            memset(base, 0, mappingSize);
+            control = new (base) controlBlock();
+            control->ringCapacity = ringCapacity;
+            new (base + sizeof(controlBlock)) ringHeader();
+            new (base + sizeof(controlBlock) + sizeof(ringHeader) + ringCapacity) ringHeader();
+
+            if (!attachRings()) {
+                close();
+                return false;
+            }
+
+            control->version = VERSION;
+            control->serverAttached.store(1, std::memory_order_release);
+            // magic last, an opener seeing it knows the layout is complete
+            std::atomic_thread_fence(std::memory_order_release);
+            control->magic = MAGIC;
+            return true;
+        }
+
+        bool open(const std::string& mappingName) {
+            name = mappingName;
+            owner = false;
+
+            // map the control block first to learn the ring size
+            mappingSize = sizeof(controlBlock);
+            if (!map(mappingSize, false)) {
+                close();
+                return false;
+            }
+
+            auto header = static_cast<controlBlock*>(view);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->magic != MAGIC || header->version != VERSION) {
+                close();
+                return false;
+            }
+
+            uint64_t capacity = header->ringCapacity;
+            unmap();
+
+            mappingSize = layoutSize(capacity);
+            if (!map(mappingSize, false)) {
+                close();
+                return false;
+            }
+
+            control = static_cast<controlBlock*>(view);
+            if (!attachRings()) {
+                close();
+                return false;
+            }
+
+            control->clientAttached.store(1, std::memory_order_release);
+            // wake the creator so it notices the new peer
+            outgoing().wake();
+            return true;
+        }
+
+        void close() {
+            if (control) {
+                (owner ? control->serverAttached : control->clientAttached).store(0, std::memory_order_release);
+                // let the other side notice right away instead of at its next timeout
+                outgoing().wake();
+            }
+
+            requests.detach();
+            responses.detach();
+            control = nullptr;
+            unmap();
+        }
+
+        bool isOpen() const {
+            return control != nullptr;
+        }
+
+        bool peerAttached() const {
+            if (!control) {
+                return false;
+            }
+            return (owner ? control->clientAttached : control->serverAttached).load(std::memory_order_acquire) != 0;
+        }
+
+        size_t maxMessage() {
+            return outgoing().maxMessage();
+        }
+
+        writeResult send(uint32_t kind, const void* data, size_t size) {
+            return control ? outgoing().write(kind, data, size) : write_failed;
+        }
+
+        // For producers allowed to block: the sequence to pass to waitForSpace before trying again
+        uint32_t spaceSequence() {
+            return control ? outgoing().spaceSequence() : 0;
+        }
+
+        void waitForSpace(uint32_t seen, std::chrono::milliseconds timeout) {
+            if (control) {
+                outgoing().waitForSpace(seen, timeout);
+            }
+        }
+
+        // Hands every waiting message to handler(kind, bytes, size), returns how many there were
+        template<typename Handler>
+        size_t poll(Handler&& handler) {
+            return control ? incoming().read(std::forward<Handler>(handler)) : 0;
+        }
+
+        // The peer wrote garbage into the incoming ring. Nothing more is read from it, the link has to be
+        // closed and set up again.
+        bool corrupt() {
+            return control && incoming().isCorrupt();
+        }
+
+        // Blocks until something arrives (or the peer attaches / leaves) or the timeout runs out
+        void wait(uint32_t seen, std::chrono::milliseconds timeout) {
+            if (control) {
+                incoming().wait(seen, timeout);
+            }
+        }
+
+        uint32_t sequence() {
+            return control ? incoming().sequence() : 0;
+        }
+    };
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "transport.h"
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <string>
+#include <thread>
+#include "logging.h"
+#include "shm_ring.h"
+
+// shm://name endpoint, the creating side of a shm::Link driven by a reader thread
+class ShmTransport : public Transport {
+private:
+    // a full ring is retried this often, a message stuck longer than SEND_TIMEOUT is dropped
+    static constexpr std::chrono::milliseconds RETRY_INTERVAL{ 1 };
+    static constexpr std::chrono::milliseconds SEND_TIMEOUT{ 100 };
+
+    transport::executor strand;
+    shm::Link link;
+    std::string linkName;
+    transport::Handlers handlers;
+    std::thread reader;
+    std::atomic<bool> running{ false };
+    std::atomic<bool> connected{ false };
+
+    // only touched on the strand
+    std::deque<transport::Message> pending;
+    std::optional<std::chrono::steady_clock::time_point> stalledSince;
+    net::steady_timer retry_timer;
+    bool retryScheduled = false;
+
+    // The bridge wrote something the ring can't make sense of. Set the mapping up from scratch on the
+    // strand, the only other user of the link, and make the bridge attach again.
+    void drop_link() {
+        logger::addLog("[SHM] Corrupt record from bridge, dropping the link");
+        if (connected) {
+            connected = false;
+            if (handlers.disconnected) {
+                handlers.disconnected();
+            }
+        }
+
+        transport::runOnStrand(strand, [this]() {
+            release_link();
+            // close() may be waiting on this thread, it tears the link down for good
+            if (running && !link.create(linkName)) {
+                logger::addLog("[SHM] Failed to recreate shared memory " + linkName);
+            }
+            });
+    }
+
+    // Runs on the strand: nothing queued or scheduled outlives the link it was meant for
+    void release_link() {
+        retry_timer.cancel();
+        pending.clear();
+        stalledSince.reset();
+        link.close();
+    }
+
+    void read_loop() {
+        while (running) {
+            uint32_t seen = link.sequence();
+            bool attached = link.peerAttached();
+
+            if (attached != connected) {
+                connected = attached;
+                logger::addLog(attached ? "[SHM] Bridge attached" : "[SHM] Bridge detached");
+
+                auto& handler = attached ? handlers.connected : handlers.disconnected;
+                if (handler) {
+                    handler();
+                }
+            }
+
+            size_t handled = link.poll([this](uint32_t kind, const uint8_t* data, size_t size) {
+                if (handlers.message) {
+                    handlers.message(kind == shm::record_binary, data, size);
+                }
+                });
+
+            if (link.corrupt()) {
+                drop_link();
+                continue;
+            }
+
+            if (!handled) {
+                link.wait(seen, std::chrono::milliseconds(100));
+            }
+        }
+    }
+
+    // Each message is its own ring record, nothing to gather. Runs on the strand, the ring has a single
+    // producer. A full ring never blocks the strand: what's left waits in pending for the retry timer.
+    void flush() {
+        while (!pending.empty()) {
+            auto& message = pending.front();
+            uint32_t kind = message.binary ? shm::record_binary : shm::record_text;
+            auto result = link.send(kind, message.data(), message.size());
+
+            if (result == shm::write_full) {
+                auto now = std::chrono::steady_clock::now();
+                if (!stalledSince) {
+                    stalledSince = now;
+                }
+                if (now - *stalledSince < SEND_TIMEOUT) {
+                    schedule_retry();
+                    return;
+                }
+            }
+
+            if (result != shm::write_ok) {
+                logger::addLog("[SHM] Send failed, dropping " + std::to_string(message.size()) + " byte message");
+            }
+            pending.pop_front();
+            stalledSince.reset();
+        }
+    }
+
+    void schedule_retry() {
+        if (retryScheduled) {
+            return;
+        }
+
+        retryScheduled = true;
+        retry_timer.expires_after(RETRY_INTERVAL);
+        retry_timer.async_wait([this](boost::system::error_code ec) {
+            retryScheduled = false;
+            if (!ec && running) {
+                flush();
+            }
+            });
+    }
+
+public:
+    explicit ShmTransport(transport::executor executor)
+        : strand(executor), retry_timer(executor)
+    {
+    }
+
+    ~ShmTransport() {
+        close();
+    }
+
+    const char* name() const override {
+        return "shm";
+    }
+
+    bool open(const transport::Endpoint& endpoint, transport::Handlers transportHandlers) override {
+        handlers = std::move(transportHandlers);
+
+        linkName = endpoint.path;
+        if (!link.create(endpoint.path)) {
+            logger::addLog("[SHM] Failed to create shared memory " + endpoint.path);
+            return false;
+        }
+
+        logger::addLog("[SHM] Waiting for bridge on shared memory: " + endpoint.path);
+        running = true;
+        reader = std::thread([this]() { read_loop(); });
+        return true;
+    }
+
+    void close() override {
+        running = false;
+        if (reader.joinable()) {
+            reader.join();
+        }
+        // the link and the retry timer belong to the strand
+        transport::runOnStrand(strand, [this]() { release_link(); });
+        connected = false;
+    }
+
+    bool is_connected() const override {
+        return connected;
+    }
+
+    void send(transport::Message message) override {
+        net::post(strand, [this, message = std::move(message)]() mutable {
+            if (!running) {
+                return;
+            }
+            pending.push_back(std::move(message));
+            flush();
+            });
+    }
+
+    void send_batch(std::vector<transport::Message> messages) override {
+        net::post(strand, [this, messages = std::move(messages)]() mutable {
+            if (!running) {
+                return;
+            }
+            for (auto& message : messages) {
+                pending.push_back(std::move(message));
+            }
+            flush();
+            });
+    }
+};
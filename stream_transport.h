@@ -0,0 +1,303 @@
+#pragma once
+
+#include "transport.h"
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include "logging.h"
+
+// Plain stream socket with length-prefixed messages, no WebSocket handshake, masking or per-frame
+// headers. Serves tcp:// and unix:// endpoints for bridges that can open a raw socket.
+template<typename Protocol>
+class StreamTransport : public Transport {
+private:
+    static constexpr size_t HEADER_SIZE = 8;
+    // anything bigger is a corrupt stream, drop the connection
+    static constexpr uint32_t MAX_MESSAGE = 64 * 1024 * 1024;
+    // upper bound for messages gathered into one write
+    static constexpr size_t MAX_GATHER_BYTES = 256 * 1024;
+
+    using socket_type = typename Protocol::socket;
+    using acceptor_type = typename Protocol::acceptor;
+
+    // One client. Its read buffers, write queue and the buffers of the write in progress belong to it,
+    // so a client taking over never frees or clears anything an operation on the old socket still
+    // points into.
+    struct Connection {
+        socket_type socket;
+
+        // only touched on the strand
+        std::array<uint8_t, HEADER_SIZE> read_header{};
+        std::vector<uint8_t> read_buffer;
+        std::deque<transport::Message> write_queue;
+        std::vector<transport::Message> writing;
+        std::vector<std::array<uint8_t, HEADER_SIZE>> write_headers;
+        std::vector<net::const_buffer> write_buffers;
+
+        explicit Connection(socket_type accepted)
+            : socket(std::move(accepted))
+        {
+        }
+    };
+
+    transport::executor strand;
+    std::optional<acceptor_type> acceptor;
+    transport::Handlers handlers;
+    const char* transportName;
+
+    // the current client, only touched on the strand
+    std::shared_ptr<Connection> connection;
+    std::atomic<bool> connected{ false };
+    bool running = false;
+    std::string socketPath;
+
+    static void encodeHeader(std::array<uint8_t, HEADER_SIZE>& header, const transport::Message& message) {
+        uint32_t length = static_cast<uint32_t>(message.size());
+        header.fill(0);
+        for (int i = 0; i < 4; i++) {
+            header[i] = static_cast<uint8_t>(length >> (8 * i));
+        }
+        header[4] = message.binary ? transport::kind_binary : transport::kind_text;
+    }
+
+    void disconnect(std::shared_ptr<Connection> current, const std::string& reason) {
+        if (current != connection) {
+            return;
+        }
+
+        logger::addLog(std::string("[") + transportName + "] Client disconnected: " + reason);
+        boost::system::error_code ec;
+        current->socket.close(ec);
+        current->write_queue.clear();
+        connection.reset();
+        connected = false;
+        if (handlers.disconnected) {
+            handlers.disconnected();
+        }
+    }
+
+    void do_accept() {
+        acceptor->async_accept([this](boost::system::error_code ec, socket_type accepted) {
+            if (!ec) {
+                logger::addLog(std::string("[") + transportName + "] Client connected");
+
+                // whatever the previous client still had queued or in flight stays with it
+                if (connection) {
+                    boost::system::error_code ignored;
+                    connection->socket.close(ignored);
+                }
+
+                auto current = std::make_shared<Connection>(std::move(accepted));
+                if constexpr (std::is_same_v<Protocol, tcp>) {
+                    current->socket.set_option(tcp::no_delay(true));
+                }
+
+                connection = current;
+                connected = true;
+                if (handlers.connected) {
+                    handlers.connected();
+                }
+                read_message(current);
+            }
+
+            if (running) {
+                do_accept();
+            }
+            });
+    }
+
+    void read_message(std::shared_ptr<Connection> current) {
+        net::async_read(current->socket, net::buffer(current->read_header), net::bind_executor(strand,
+            [this, current](boost::system::error_code ec, std::size_t) {
+                if (ec) {
+                    disconnect(current, ec.message());
+                    return;
+                }
+
+                uint32_t length = 0;
+                for (int i = 0; i < 4; i++) {
+                    length |= uint32_t(current->read_header[i]) << (8 * i);
+                }
+
+                if (length > MAX_MESSAGE) {
+                    disconnect(current, "message too large (" + std::to_string(length) + " bytes)");
+                    return;
+                }
+
+                // resize keeps the capacity, steady-state reads don't allocate
+                current->read_buffer.resize(length);
+                net::async_read(current->socket, net::buffer(current->read_buffer), net::bind_executor(strand,
+                    [this, current](boost::system::error_code ec, std::size_t) {
+                        if (ec) {
+                            disconnect(current, ec.message());
+                            return;
+                        }
+
+                        // a newer client took over, this socket is done
+                        if (current != connection) {
+                            return;
+                        }
+
+                        if (handlers.message) {
+                            auto& buffer = current->read_buffer;
+                            handlers.message(current->read_header[4] == transport::kind_binary, buffer.data(), buffer.size());
+                        }
+
+                        if (running && current == connection) {
+                            read_message(current);
+                        }
+                    }));
+            }));
+    }
+
+    // Every message carries its own length, so whatever is queued goes out in one gathered write
+    void do_write(std::shared_ptr<Connection> current) {
+        if (!current->writing.empty() || current->write_queue.empty()) {
+            return;
+        }
+
+        auto& write_queue = current->write_queue;
+        auto& writing = current->writing;
+        auto& write_headers = current->write_headers;
+        auto& write_buffers = current->write_buffers;
+
+        size_t gathered = 0;
+        do {
+            gathered += write_queue.front().size() + HEADER_SIZE;
+            writing.push_back(std::move(write_queue.front()));
+            write_queue.pop_front();
+        } while (!write_queue.empty() && gathered + write_queue.front().size() <= MAX_GATHER_BYTES);
+
+        // sized up front, the buffers below point into it
+        write_headers.resize(writing.size());
+        write_buffers.clear();
+        for (size_t i = 0; i < writing.size(); i++) {
+            encodeHeader(write_headers[i], writing[i]);
+            write_buffers.push_back(net::buffer(write_headers[i]));
+            write_buffers.push_back(net::buffer(writing[i].data(), writing[i].size()));
+        }
+
+        // the handler holds the connection, and with it the messages and headers the buffers point into
+        net::async_write(current->socket, write_buffers, net::bind_executor(strand,
+            [this, current](boost::system::error_code ec, std::size_t) {
+                current->writing.clear();
+
+                // a client that was replaced meanwhile just drains away with its own queue
+                if (current != connection) {
+                    return;
+                }
+
+                if (ec) {
+                    logger::addLog(std::string("[") + transportName + "] Send error: " + ec.message());
+                    disconnect(current, ec.message());
+                    return;
+                }
+
+                do_write(current);
+            }));
+    }
+
+public:
+    StreamTransport(transport::executor executor, const char* name)
+        : strand(executor), transportName(name)
+    {
+    }
+
+    const char* name() const override {
+        return transportName;
+    }
+
+    bool open(const transport::Endpoint& endpoint, transport::Handlers transportHandlers) override {
+        handlers = std::move(transportHandlers);
+
+        try {
+            typename Protocol::endpoint local;
+            if constexpr (std::is_same_v<Protocol, tcp>) {
+                local = tcp::endpoint(net::ip::make_address(endpoint.host), endpoint.port);
+            }
+            else {
+                // a socket file left behind by a previous run would make bind fail
+                socketPath = endpoint.path;
+                std::remove(socketPath.c_str());
+                local = typename Protocol::endpoint(socketPath);
+            }
+
+            acceptor.emplace(strand);
+            acceptor->open(local.protocol());
+            if constexpr (std::is_same_v<Protocol, tcp>) {
+                acceptor->set_option(net::socket_base::reuse_address(true));
+            }
+            acceptor->bind(local);
+            acceptor->listen();
+        }
+        catch (const std::exception& e) {
+            logger::addLog(std::string("[") + transportName + "] Failed to listen on " + endpoint.describe() + ": " + e.what());
+            acceptor.reset();
+            return false;
+        }
+
+        logger::addLog(std::string("[") + transportName + "] Listening on " + endpoint.describe());
+        running = true;
+        net::post(strand, [this]() { do_accept(); });
+        return true;
+    }
+
+    void close() override {
+        running = false;
+        connected = false;
+
+        // the sockets belong to the strand, pending operations complete there with an error
+        transport::runOnStrand(strand, [this]() {
+            boost::system::error_code ec;
+            if (connection) {
+                connection->socket.close(ec);
+                connection.reset();
+            }
+            if (acceptor) {
+                acceptor->close(ec);
+            }
+            });
+
+        if (!socketPath.empty()) {
+            std::remove(socketPath.c_str());
+        }
+    }
+
+    bool is_connected() const override {
+        return connected;
+    }
+
+    void send(transport::Message message) override {
+        net::post(strand, [this, message = std::move(message)]() mutable {
+            if (!connection) {
+                return;
+            }
+            connection->write_queue.push_back(std::move(message));
+            do_write(connection);
+            });
+    }
+
+    void send_batch(std::vector<transport::Message> messages) override {
+        net::post(strand, [this, messages = std::move(messages)]() mutable {
+            if (!connection) {
+                return;
+            }
+            for (auto& message : messages) {
+                connection->write_queue.push_back(std::move(message));
+            }
+            do_write(connection);
+            });
+    }
+};
+
+using TcpTransport = StreamTransport<tcp>;
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+using UnixTransport = StreamTransport<net::local::stream_protocol>;
+#endif
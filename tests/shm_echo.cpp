@@ -0,0 +1,213 @@
+// Linux/POSIX check for shm_ring.h: a forked stand-in bridge open()s the link and echoes every record
+// back, the parent sends messages of varying size across many ring wraps and checks what comes back.
+// Then a record header is overwritten in the mapping to check the reader refuses it.
+//
+//   g++ -std=c++20 -O2 -I.. shm_echo.cpp -o shm_echo && ./shm_echo
+//
+// Exits 0 on success.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "shm_ring.h"
+
+namespace {
+    constexpr int MESSAGES = 5000;
+    constexpr uint64_t RING_CAPACITY = 64 * 1024;
+
+    int failures = 0;
+
+    void expect(bool condition, const char* what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAIL: %s\n", what);
+            failures++;
+        }
+    }
+
+    // sizes from empty to close to the largest record, so the ring wraps at every possible offset
+    size_t messageSize(int i, size_t largest) {
+        return (static_cast<size_t>(i) * 2654435761u) % (largest + 1);
+    }
+
+    uint8_t messageByte(int i, size_t offset) {
+        return static_cast<uint8_t>(i * 31 + offset);
+    }
+
+    bool sendRetrying(shm::Link& link, uint32_t kind, const void* data, size_t size) {
+        for (int attempt = 0; attempt < 1000; attempt++) {
+            uint32_t seen = link.spaceSequence();
+            if (link.send(kind, data, size) == shm::write_ok) {
+                return true;
+            }
+            link.waitForSpace(seen, std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+    int runBridge(const std::string& name) {
+        shm::Link link;
+        for (int attempt = 0; !link.open(name); attempt++) {
+            if (attempt > 1000) {
+                return 2;
+            }
+            usleep(1000);
+        }
+
+        int echoed = 0;
+        std::vector<uint8_t> copy;
+        while (echoed < MESSAGES && link.peerAttached()) {
+            uint32_t seen = link.sequence();
+            size_t handled = link.poll([&](uint32_t kind, const uint8_t* data, size_t size) {
+                // the view is only valid during the call and sending may have to wait for room
+                copy.assign(data, data + size);
+                if (sendRetrying(link, kind, copy.data(), copy.size())) {
+                    echoed++;
+                }
+                });
+            if (!handled) {
+                link.wait(seen, std::chrono::milliseconds(100));
+            }
+        }
+
+        link.close();
+        return echoed == MESSAGES ? 0 : 3;
+    }
+
+    // A peer that writes a record claiming more bytes than it wrote: the reader must stop, not hand out a
+    // view past what's in the ring
+    void checkCorruptRecord() {
+        std::string name = "imclass_shm_corrupt_" + std::to_string(getpid());
+
+        shm::Link server;
+        shm::Link client;
+        if (!server.create(name, RING_CAPACITY) || !client.open(name)) {
+            expect(false, "corrupt test link set up");
+            return;
+        }
+
+        uint8_t payload[16] = {};
+        expect(client.send(shm::record_binary, payload, sizeof(payload)) == shm::write_ok, "client record written");
+
+        // the response ring's first record header sits right behind its ring header
+        int fd = shm_open(("/" + name).c_str(), O_RDWR, 0);
+        size_t mappingSize = sizeof(shm::controlBlock) + 2 * (sizeof(shm::ringHeader) + RING_CAPACITY);
+        void* view = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (view == MAP_FAILED) {
+            expect(false, "corrupt test mapping");
+            return;
+        }
+
+        auto responses = static_cast<uint8_t*>(view) + sizeof(shm::controlBlock) + sizeof(shm::ringHeader) + RING_CAPACITY;
+        shm::recordHeader forged{ static_cast<uint32_t>(RING_CAPACITY * 4), shm::record_binary };
+        memcpy(responses + sizeof(shm::ringHeader), &forged, sizeof(forged));
+
+        bool handed = false;
+        size_t handled = server.poll([&](uint32_t, const uint8_t*, size_t) { handed = true; });
+        expect(!handled && !handed, "forged record not handed out");
+        expect(server.corrupt(), "forged record marks the link corrupt");
+
+        munmap(view, mappingSize);
+        client.close();
+        server.close();
+    }
+}
+
+int main() {
+    std::string name = "imclass_shm_echo_" + std::to_string(getpid());
+
+    shm::Link link;
+    if (!link.create(name, RING_CAPACITY)) {
+        std::fprintf(stderr, "FAIL: create\n");
+        return 1;
+    }
+
+    pid_t bridge = fork();
+    if (bridge == 0) {
+        // the inherited creator side is left alone, closing it would detach and unlink the parent's link
+        _exit(runBridge(name));
+    }
+
+    for (int attempt = 0; !link.peerAttached(); attempt++) {
+        if (attempt > 2000) {
+            std::fprintf(stderr, "FAIL: bridge never attached\n");
+            return 1;
+        }
+        usleep(1000);
+    }
+
+    // too big for the ring at all
+    std::vector<uint8_t> huge(link.maxMessage() + 1);
+    expect(link.send(shm::record_binary, huge.data(), huge.size()) == shm::write_failed, "oversized message rejected");
+
+    size_t largest = link.maxMessage() / 4;
+    std::vector<uint8_t> message;
+    int sent = 0;
+    int received = 0;
+
+    auto drain = [&]() {
+        return link.poll([&](uint32_t kind, const uint8_t* data, size_t size) {
+            size_t expected = messageSize(received, largest);
+            expect(kind == (received % 2 ? shm::record_text : shm::record_binary), "kind survives the round trip");
+            expect(size == expected, "size survives the round trip");
+
+            bool same = size == expected;
+            for (size_t offset = 0; same && offset < size; offset++) {
+                same = data[offset] == messageByte(received, offset);
+            }
+            expect(same, "bytes survive the round trip");
+            received++;
+            });
+    };
+
+    while (received < MESSAGES) {
+        if (sent < MESSAGES) {
+            message.resize(messageSize(sent, largest));
+            for (size_t offset = 0; offset < message.size(); offset++) {
+                message[offset] = messageByte(sent, offset);
+            }
+
+            // the echo ring fills up while we aren't reading, keep draining until there's room
+            uint32_t kind = sent % 2 ? shm::record_text : shm::record_binary;
+            while (link.send(kind, message.data(), message.size()) != shm::write_ok) {
+                uint32_t seen = link.sequence();
+                if (!drain()) {
+                    link.wait(seen, std::chrono::milliseconds(10));
+                }
+            }
+            sent++;
+            drain();
+            continue;
+        }
+
+        uint32_t seen = link.sequence();
+        if (!drain()) {
+            link.wait(seen, std::chrono::milliseconds(100));
+            int status = 0;
+            if (waitpid(bridge, &status, WNOHANG) == bridge && received < MESSAGES) {
+                std::fprintf(stderr, "FAIL: bridge exited early (%d)\n", WEXITSTATUS(status));
+                return 1;
+            }
+        }
+    }
+
+    int status = 0;
+    waitpid(bridge, &status, 0);
+    expect(WIFEXITED(status) && WEXITSTATUS(status) == 0, "bridge echoed everything and exited cleanly");
+
+    link.close();
+
+    checkCorruptRecord();
+
+    if (failures) {
+        std::fprintf(stderr, "%d failure(s)\n", failures);
+        return 1;
+    }
+    std::printf("shm echo: %d messages round-tripped, forged record refused\n", MESSAGES);
+    return 0;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+// Force WinSock2 FIRST
+#ifndef _WINSOCKAPI_
+#define _WINSOCKAPI_
+#endif
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0601
+#endif
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include <boost/asio.hpp>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace transport {
+    using executor = net::strand<net::io_context::executor_type>;
+
+    // One outgoing message, text is a JSON message and frame one or more protocol frames
+    struct Message {
+        std::string text;
+        std::vector<uint8_t> frame;
+        bool binary = false;
+
+        size_t size() const { return binary ? frame.size() : text.size(); }
+        const void* data() const { return binary ? static_cast<const void*>(frame.data()) : static_cast<const void*>(text.data()); }
+    };
+
+    // Length-prefixed framing used by the stream transports: [u32 length][u8 kind][3 reserved] then length bytes
+    enum messageKind : uint8_t {
+        kind_text = 1,
+        kind_binary = 2,
+    };
+
+    // Transports call these from their own thread (the io strand, or the shm reader), data is only
+    // valid for the duration of the call
+    struct Handlers {
+        std::function<void()> connected;
+        std::function<void()> disconnected;
+        std::function<void(bool binary, const uint8_t* data, size_t size)> message;
+    };
+
+    // Runs task on the strand and waits for it, for teardown called from another thread. Once the io
+    // context has stopped nothing else runs strand work any more, so the caller runs it itself.
+    inline void runOnStrand(const executor& strand, std::function<void()> task) {
+        auto& context = strand.get_inner_executor().context();
+        if (strand.running_in_this_thread() || context.stopped()) {
+            task();
+            return;
+        }
+
+        // whichever side claims it first runs the task, never both
+        auto claimed = std::make_shared<std::atomic<bool>>(false);
+        auto finished = std::make_shared<std::promise<void>>();
+        auto done = finished->get_future();
+        net::post(strand, [task, claimed, finished]() {
+            if (!claimed->exchange(true)) {
+                task();
+            }
+            finished->set_value();
+            });
+
+        while (done.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready) {
+            if (context.stopped() && !claimed->exchange(true)) {
+                task();
+                return;
+            }
+        }
+    }
+
+    // ws://host:port, tcp://host:port, unix://path or shm://name
+    struct Endpoint {
+        std::string scheme;
+        std::string host;
+        uint16_t port = 0;
+        std::string path;
+
+        static constexpr const char* DEFAULT = "ws://0.0.0.0:9001";
+
+        static bool parse(const std::string& text, Endpoint& out) {
+            size_t separator = text.find("://");
+            if (separator == std::string::npos) {
+                return false;
+            }
+
+            Endpoint endpoint;
+            endpoint.scheme = text.substr(0, separator);
+            std::string rest = text.substr(separator + 3);
+
+            if (endpoint.scheme == "ws" || endpoint.scheme == "tcp") {
+                size_t colon = rest.rfind(':');
+                if (colon == std::string::npos || colon == 0) {
+                    return false;
+                }
+
+                endpoint.host = rest.substr(0, colon);
+                auto result = std::from_chars(rest.data() + colon + 1, rest.data() + rest.size(), endpoint.port);
+                if (result.ec != std::errc() || !endpoint.port) {
+                    return false;
+                }
+            }
+            else if (endpoint.scheme == "unix" || endpoint.scheme == "shm") {
+                if (rest.empty()) {
+                    return false;
+                }
+                endpoint.path = rest;
+            }
+            else {
+                return false;
+            }
+
+            out = std::move(endpoint);
+            return true;
+        }
+
+        std::string describe() const {
+            if (!path.empty()) {
+                return scheme + "://" + path;
+            }
+            return scheme + "://" + host + ":" + std::to_string(port);
+        }
+    };
+}
+
+// A link to the bridge. BridgeServer only talks to this, so the wire (WebSocket, raw stream socket,
+// shared memory) can be swapped by endpoint without touching the request layer.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual const char* name() const = 0;
+
+    // Starts listening for the bridge, connection changes and messages come in through handlers
+    virtual bool open(const transport::Endpoint& endpoint, transport::Handlers handlers) = 0;
+    virtual void close() = 0;
+
+    virtual bool is_connected() const = 0;
+
+    // Never blocks the caller
+    virtual void send(transport::Message message) = 0;
+
+    virtual void send_batch(std::vector<transport::Message> messages) {
+        for (auto& message : messages) {
+            send(std::move(message));
+        }
+    }
+
+    // Whether consecutive text messages may be merged into a batch envelope, only meaningful for
+    // transports that can't frame several messages on their own
+    virtual void set_text_batching(bool enabled) {}
+};
@@ -20,9 +20,12 @@ namespace ui {
     bool exportWindow = false;
     bool consoleWindow = true;  // Console visible by default
     bool moduleListWindow = false;
+    bool bridgeStatsWindow = false;
 
     std::string exportedClass;
     inline std::optional<PatternScanResult> patternResults;
+    inline std::future<uintptr_t> pendingScan;
+    inline std::string pendingScanTag;
     char addressInput[256] = "0";
     char module[512] = { 0 };
     char signature[512] = { 0 };
@@ -50,6 +53,8 @@ namespace ui {
     void renderModals();
     void renderConsoleWindow();
     void renderModuleListWindow();
+    void renderBridgeStatsWindow();
+    void pollPatternScan();
 }
 
 // reused for small tool windows
@@ -113,15 +118,8 @@ inline void ui::renderSignatureScan()
 
         PatternInfo pattern;
         pattern.pattern = signature;
-        patternResults = pattern::scanPattern(pattern, module);
-
-        if (patternResults.has_value() && !patternResults.value().matches.empty()) {
-            logger::addLog("[Signature] Found " + std::to_string(patternResults.value().matches.size()) + " matches");
-            signaturesWindow = true;
-        }
-        else {
-            logger::addLog("[Signature] No matches found");
-        }
+        pendingScan = pattern::scanPatternAsync(pattern, module);
+        pendingScanTag = "[Signature]";
 
         sigScanWindow = false;
     }
@@ -180,15 +178,8 @@ inline void ui::renderStringScan()
         pattern.pattern = patternString;
         pattern.type = PatternType::BYTE_PATTERN;
 
-        patternResults = pattern::scanPattern(pattern, module, std::nullopt);
-
-        if (patternResults.has_value() && !patternResults.value().matches.empty()) {
-            logger::addLog("[String] Found " + std::to_string(patternResults.value().matches.size()) + " matches");
-            signaturesWindow = true;
-        }
-        else {
-            logger::addLog("[String] No matches found");
-        }
+        pendingScan = pattern::scanPatternAsync(pattern, module, std::nullopt);
+        pendingScanTag = "[String]";
 
         stringSearchWindow = false;
     }
@@ -203,6 +194,29 @@ inline void ui::renderStringScan()
 }
 
 
+// Scans run on the bridge, the result is picked up here once it arrives instead of stalling the frame
+void ui::pollPatternScan() {
+    if (!pendingScan.valid() || pendingScan.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+
+    uintptr_t result = 0;
+    if (!mem::waitResult(pendingScan, std::chrono::milliseconds(0), result)) {
+        logger::addLog(pendingScanTag + " Scan failed");
+    }
+    pendingScan = {};
+
+    patternResults = pattern::toScanResult(result);
+
+    if (patternResults.has_value() && !patternResults.value().matches.empty()) {
+        logger::addLog(pendingScanTag + " Found " + std::to_string(patternResults.value().matches.size()) + " matches");
+        signaturesWindow = true;
+    }
+    else {
+        logger::addLog(pendingScanTag + " No matches found");
+    }
+}
+
 void ui::renderSignatureResults() {
     static bool oSignaturesWindow = false;
     if (!signaturesWindow) {
@@ -312,6 +326,9 @@ void ui::renderMain() {
             if (ImGui::MenuItem("Console", nullptr, consoleWindow)) {
                 consoleWindow = !consoleWindow;
             }
+            if (ImGui::MenuItem("Bridge Stats", nullptr, bridgeStatsWindow)) {
+                bridgeStatsWindow = !bridgeStatsWindow;
+            }
             ImGui::EndMenu();
         }
 
@@ -337,7 +354,7 @@ void ui::renderMain() {
         }
 
         // Show perception connection status
-        if (g_WebSocketServer.is_connected()) {
+        if (g_Bridge.is_connected()) {
             ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.0f, 1.0f, 0.0f, 1.0f));
             ImGui::Text("perception.cx connected");
             ImGui::PopStyleColor();
@@ -456,6 +473,10 @@ void ui::renderMain() {
 
         oInputFocused = inputFocused;
 
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(120);
+        ImGui::SliderInt("Refresh", &sClass.refreshRate, 0, 240, sClass.refreshRate ? "%d Hz" : "auto");
+
         ImGui::BeginChild("MemView", ImVec2(0, 0), 0, g_HoveringPointer ? ImGuiWindowFlags_NoScrollWithMouse : 0);
         g_HoveringPointer = false;
         g_InPopup = false;
@@ -612,6 +633,102 @@ void ui::renderModuleListWindow() {
     ImGui::End();
 }
 
+void ui::renderBridgeStatsWindow() {
+    if (!bridgeStatsWindow) return;
+
+    ImGui::Begin("Bridge Stats", &bridgeStatsWindow);
+
+    auto flow = g_Bridge.flow_stats();
+    auto session = g_Bridge.session();
+
+    ImGui::Text("Transport: %s (%s)", g_Bridge.transport_name(), g_Bridge.is_connected() ? "connected" : "disconnected");
+    ImGui::Text("Protocol v%u, max frame %u bytes, batching %s", session.version, session.maxFrame, session.batch ? "on" : "off");
+
+    ImGui::Separator();
+
+    static int window = static_cast<int>(flow.window);
+    if (ImGui::SliderInt("In-flight window", &window, 1, 1024)) {
+        g_Bridge.set_window(static_cast<uint32_t>(window));
+    }
+
+    ImGui::Text("In flight: %u / %u", flow.in_flight, flow.window);
+    ImGui::Text("Queued: %zu (peak %zu)", flow.queued, flow.peak_queued);
+    ImGui::Text("  interactive %zu, preview %zu, normal %zu, background %zu",
+        flow.queued_by_priority[priority_interactive], flow.queued_by_priority[priority_preview],
+        flow.queued_by_priority[priority_normal], flow.queued_by_priority[priority_background]);
+    ImGui::Text("Deferred: %llu, dropped: %llu, expired: %llu", flow.deferred, flow.dropped, flow.expired);
+
+    auto reads = mem::g_ReadCoalescer.stats();
+    ImGui::Text("Reads: %llu requested, %llu attached, %llu merged, %llu sent", reads.requested, reads.attached, reads.merged, reads.sent);
+    ImGui::Text("Read bytes: %llu KiB asked, %llu KiB sent", reads.bytesRequested / 1024, reads.bytesSent / 1024);
+
+    size_t subscribed = 0, pushing = 0;
+    {
+        std::lock_guard<std::mutex> lock(mem::g_SubscriptionMutex);
+        subscribed = mem::g_Subscriptions.size();
+        for (auto& sub : mem::g_Subscriptions) {
+            pushing += sub.pushing;
+        }
+    }
+    ImGui::Text("Subscriptions: %zu (%zu pushing)%s", subscribed, pushing, g_Bridge.can_subscribe() ? "" : ", bridge can't push");
+
+    auto pushes = g_Bridge.push_stats();
+    ImGui::Text("Pushes: %llu full, %llu delta, %llu KiB, %llu resyncs", pushes.full, pushes.delta, pushes.bytes / 1024, pushes.resyncs);
+
+    auto compression = g_Bridge.compression_stats();
+    ImGui::Text("Compressed: %llu frames, %llu KiB -> %llu KiB (%.0f%%), %llu us avg inflate, %llu failed",
+        compression.frames, compression.wire_bytes / 1024, compression.raw_bytes / 1024,
+        compression.raw_bytes ? 100.0 * compression.wire_bytes / compression.raw_bytes : 100.0,
+        compression.frames ? compression.inflate_us / compression.frames : 0, compression.failures);
+
+    auto cache = mem::g_MemoryCache.stats();
+    ImGui::Text("Cache: %zu pages (%zu unreadable), %zu / %zu KiB, generation %llu", cache.pages, cache.negativePages,
+        cache.bytes / 1024, cache.budget / 1024, cache.generation);
+    ImGui::Text("  %llu hits, %llu misses, %llu unreadable, %llu evictions, %llu prefetched",
+        cache.hits, cache.misses, cache.unreadable, cache.evictions, mem::g_Prefetched.load());
+
+    auto refresh = g_RefreshScheduler.stats();
+    static int refreshKiB = static_cast<int>(refresh.bytesPerSecond / 1024);
+    static int refreshRequests = static_cast<int>(refresh.requestsPerSecond);
+    bool budgetChanged = ImGui::SliderInt("Refresh KiB/s", &refreshKiB, 0, 65536, refreshKiB ? "%d" : "unlimited");
+    budgetChanged |= ImGui::SliderInt("Refresh requests/s", &refreshRequests, 0, 10000, refreshRequests ? "%d" : "unlimited");
+    if (budgetChanged) {
+        g_RefreshScheduler.setBudget(static_cast<uint64_t>(refreshKiB) * 1024, static_cast<uint64_t>(refreshRequests));
+    }
+    ImGui::Text("Refresh: %zu regions (%zu hot), %llu scheduled, %llu changed, %llu unchanged, %llu over budget",
+        refresh.regions, refresh.hot, refresh.scheduled, refresh.changed, refresh.unchanged, refresh.overBudget);
+
+    ImGui::Separator();
+
+    if (ImGui::BeginTable("LatencyTable", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable)) {
+        ImGui::TableSetupColumn("Request", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("Count", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+        ImGui::TableSetupColumn("Avg RTT (us)", ImGuiTableColumnFlags_WidthFixed, 100.0f);
+        ImGui::TableSetupColumn("Max RTT (us)", ImGuiTableColumnFlags_WidthFixed, 100.0f);
+        ImGui::TableSetupColumn("Avg callback (us)", ImGuiTableColumnFlags_WidthFixed, 120.0f);
+        ImGui::TableHeadersRow();
+
+        for (const auto& [type, stats] : g_Bridge.latency_stats()) {
+            ImGui::TableNextRow();
+
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", type.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", stats.count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", stats.count ? stats.totalRoundTripUs / stats.count : 0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", stats.maxRoundTripUs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", stats.count ? stats.totalRunUs / stats.count : 0);
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
 bool ui::searchMatches(std::string str, std::string term) {
     std::transform(str.begin(), str.end(), str.begin(), tolower);
     std::transform(term.begin(), term.end(), term.begin(), tolower);
@@ -619,6 +736,7 @@ bool ui::searchMatches(std::string str, std::string term) {
 }
 
 void ui::render() {
+    pollPatternScan();
     renderMain();
     renderProcessWindow();
     renderExportWindow();
@@ -628,6 +746,7 @@ void ui::render() {
     renderModals();
     renderConsoleWindow();
     renderModuleListWindow();
+    renderBridgeStatsWindow();
 }
 
 void ui::init(HWND hwnd) {
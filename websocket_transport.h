@@ -0,0 +1,275 @@
+#pragma once
+
+#include "transport.h"
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include "logging.h"
+#include "protocol.h"
+
+namespace beast = boost::beast;
+namespace websocket = beast::websocket;
+
+// The original link, what imclass_server.as connects to
+class WebSocketTransport : public Transport {
+private:
+    // upper bound for binary frames gathered into one websocket message
+    static constexpr size_t MAX_GATHER_BYTES = 64 * 1024;
+
+    using stream_type = websocket::stream<tcp::socket>;
+
+    // One client. Its read buffer, write queue and the buffers of the write in progress belong to it,
+    // so a client taking over never frees or clears anything an operation on the old stream still
+    // points into.
+    struct Connection {
+        stream_type stream;
+        bool ready = false;     // handshake done, writes may start
+
+        // only touched on the strand
+        // reused for every read, keeps its capacity so steady-state reads don't allocate
+        beast::flat_buffer read_buffer;
+        std::deque<transport::Message> write_queue;
+        std::vector<transport::Message> writing;
+        std::vector<net::const_buffer> write_buffers;
+
+        explicit Connection(tcp::socket socket)
+            : stream(std::move(socket))
+        {
+        }
+    };
+
+    // everything touching the socket runs on this strand, callers on other threads only post to it
+    transport::executor strand;
+    std::optional<tcp::acceptor> acceptor;
+    transport::Handlers handlers;
+
+    // the current client, only touched on the strand
+    std::shared_ptr<Connection> connection;
+    std::atomic<bool> connected{ false };
+    std::atomic<bool> text_batching{ false };
+    bool running = false;
+
+    // Closes the stream and forgets the client, its pending operations complete with an error and
+    // drop out. Nothing happens for a client that was already replaced.
+    void disconnect(std::shared_ptr<Connection> current, const std::string& reason) {
+        if (current != connection) {
+            return;
+        }
+
+        logger::addLog("[WS] Client disconnected: " + reason);
+        beast::error_code ec;
+        beast::get_lowest_layer(current->stream).close(ec);
+        current->write_queue.clear();
+        connection.reset();
+
+        if (connected.exchange(false) && handlers.disconnected) {
+            handlers.disconnected();
+        }
+    }
+
+    void do_accept() {
+        acceptor->async_accept([this](beast::error_code ec, tcp::socket socket) {
+            if (!ec) {
+                logger::addLog("[WS] Client connected");
+
+                // the previous client is closed first, whatever it still had in flight stays with it
+                if (connection) {
+                    disconnect(connection, "replaced by a new client");
+                }
+
+                auto current = std::make_shared<Connection>(std::move(socket));
+                connection = current;
+
+                current->stream.async_accept(net::bind_executor(strand, [this, current](beast::error_code ec) {
+                    if (!ec && current == connection) {
+                        current->ready = true;
+                        connected = true;
+                        if (handlers.connected) {
+                            handlers.connected();
+                        }
+                        do_read(current);
+                        do_write(current);
+                    }
+                    }));
+            }
+
+            if (running) {
+                do_accept();
+            }
+            });
+    }
+
+    void do_read(std::shared_ptr<Connection> current) {
+        current->read_buffer.clear();
+
+        current->stream.async_read(current->read_buffer, net::bind_executor(strand, [this, current](beast::error_code ec, std::size_t bytes) {
+            // a newer client took over, this stream is done
+            if (current != connection) {
+                return;
+            }
+
+            if (ec) {
+                disconnect(current, ec.message());
+                return;
+            }
+
+            // flat_buffer is contiguous, the handler gets a view straight into it
+            auto& buffer = current->read_buffer;
+            auto data = static_cast<const uint8_t*>(buffer.data().data());
+            if (handlers.message) {
+                handlers.message(current->stream.got_binary(), data, buffer.size());
+            }
+
+            if (running) {
+                do_read(current);
+            }
+            }));
+    }
+
+    // Sends whatever is queued, consecutive binary frames go out together as one message
+    // (the bridge walks every frame in a binary message), text messages one by one unless
+    // the bridge takes batch envelopes
+    void do_write(std::shared_ptr<Connection> current) {
+        if (!current->ready || !current->writing.empty() || current->write_queue.empty()) {
+            return;
+        }
+
+        auto& write_queue = current->write_queue;
+        auto& writing = current->writing;
+        auto& write_buffers = current->write_buffers;
+
+        bool binary = write_queue.front().binary;
+        bool gather = binary || text_batching;
+        size_t gathered = 0;
+
+        do {
+            gathered += write_queue.front().size();
+            writing.push_back(std::move(write_queue.front()));
+            write_queue.pop_front();
+        } while (gather && !write_queue.empty() && write_queue.front().binary == binary &&
+            gathered + write_queue.front().size() <= MAX_GATHER_BYTES);
+
+        write_buffers.clear();
+        if (binary) {
+            for (auto& message : writing) {
+                write_buffers.push_back(net::buffer(message.frame));
+            }
+        }
+        else if (writing.size() == 1) {
+            write_buffers.push_back(net::buffer(writing.front().text));
+        }
+        else {
+            static constexpr char newline = '\n';
+            write_buffers.push_back(net::buffer(protocol::batchHeader.data(), protocol::batchHeader.size()));
+            for (auto& message : writing) {
+                write_buffers.push_back(net::buffer(&newline, 1));
+                write_buffers.push_back(net::buffer(message.text));
+            }
+        }
+
+        // the handler holds the connection, and with it the messages the buffers point into
+        current->stream.binary(binary);
+        current->stream.async_write(write_buffers, net::bind_executor(strand, [this, current](beast::error_code ec, std::size_t) {
+            current->writing.clear();
+
+            // a client that was replaced meanwhile just drains away with its own queue
+            if (current != connection) {
+                return;
+            }
+
+            if (ec) {
+                logger::addLog("[WS] Send error: " + ec.message());
+                disconnect(current, ec.message());
+                return;
+            }
+
+            do_write(current);
+            }));
+    }
+
+public:
+    explicit WebSocketTransport(transport::executor executor)
+        : strand(executor)
+    {
+    }
+
+    const char* name() const override {
+        return "websocket";
+    }
+
+    bool open(const transport::Endpoint& endpoint, transport::Handlers transportHandlers) override {
+        handlers = std::move(transportHandlers);
+
+        try {
+            tcp::endpoint local(net::ip::make_address(endpoint.host), endpoint.port);
+            acceptor.emplace(strand);
+            acceptor->open(local.protocol());
+            acceptor->set_option(net::socket_base::reuse_address(true));
+            acceptor->bind(local);
+            acceptor->listen();
+        }
+        catch (const std::exception& e) {
+            logger::addLog("[WS] Failed to listen on " + endpoint.describe() + ": " + std::string(e.what()));
+            acceptor.reset();
+            return false;
+        }
+
+        logger::addLog("[WS] Starting WebSocket server on " + endpoint.describe());
+        running = true;
+        net::post(strand, [this]() { do_accept(); });
+        return true;
+    }
+
+    void close() override {
+        running = false;
+        connected = false;
+
+        // the stream belongs to the strand, pending operations complete there with an error. No close
+        // handshake: it would block the strand on a client that may never answer.
+        transport::runOnStrand(strand, [this]() {
+            beast::error_code ec;
+            if (connection) {
+                beast::get_lowest_layer(connection->stream).close(ec);
+                connection.reset();
+            }
+            if (acceptor) {
+                acceptor->close(ec);
+            }
+            });
+    }
+
+    bool is_connected() const override {
+        return connected;
+    }
+
+    void send(transport::Message message) override {
+        net::post(strand, [this, message = std::move(message)]() mutable {
+            if (!connection) {
+                return;
+            }
+            connection->write_queue.push_back(std::move(message));
+            do_write(connection);
+            });
+    }
+
+    void send_batch(std::vector<transport::Message> messages) override {
+        net::post(strand, [this, messages = std::move(messages)]() mutable {
+            if (!connection) {
+                return;
+            }
+            for (auto& message : messages) {
+                connection->write_queue.push_back(std::move(message));
+            }
+            do_write(connection);
+            });
+    }
+
+    void set_text_batching(bool enabled) override {
+        text_batching = enabled;
+    }
+};